@@ -0,0 +1,33 @@
+#include <iostream>
+
+#include "EventReplay.hpp"
+
+/* Replays event recordings (see TraceReplay::write_recording) into a fresh toaster each, as fast
+as possible, and checks every step against the recorded states. Fails when any recording doesn't
+replay the way it was recorded */
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <recording>..." << std::endl;
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        try
+        {
+            const auto report = TraceReplay::replay_events(TraceReplay::read_recording(argv[i]));
+            std::cout << argv[i] << ": " << report << std::endl;
+            failed += report.matched() ? 0 : 1;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << argv[i] << ": " << e.what() << std::endl;
+            failed++;
+        }
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "MockObjects.hpp"
+#include "ToasterActiveObject.hpp"
+
+/* Synthetic load for a fleet of toasters, to size hosts and to check queue, scheduler and timer
+changes under a realistic mix. Heaters and sensors are inert mocks: sensor streams are published
+by the generator itself.
+
+    --toasters N        fleet size (16)
+    --executor N        executor mode on an io_context run by N threads, 0 for a thread per
+                        toaster (0)
+    --threads N         generator threads, toaster i belongs to generator i % N (1)
+    --mode open|closed  open: Poisson arrivals at --rate, whatever the fleet keeps up with
+                        closed: keeps --concurrency events in flight per toaster (open)
+    --rate R            events per second of the whole fleet, open mode (10000)
+    --concurrency C     events in flight per toaster, closed mode (4)
+    --duration S        seconds of load (5)
+    --mix T,B,D,S,X     weights of toast, bake, door, stop and sensor events (2,1,2,0,15)
+    --queue-limit L     an event put while L are in flight for its toaster is dropped (1024)
+
+A stop event takes its toaster through a stop / start cycle, door events alternate between
+opening and closing. Latencies are the enqueue to transition ones of ToasterMetrics. */
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+enum Kind
+{
+    toast,
+    bake,
+    door,
+    stop,
+    sensor,
+    kind_count,
+};
+
+const char *kind_names[kind_count] = {"toast", "bake", "door", "stop", "sensor"};
+
+struct Options
+{
+    int    toasters{16};
+    int    executor_threads{0};
+    int    threads{1};
+    bool   closed{false};
+    double rate{10000.0};
+    int    concurrency{4};
+    double duration{5.0};
+    double mix[kind_count]{2, 1, 2, 0, 15};
+    int    queue_limit{1024};
+};
+
+struct Target
+{
+    std::shared_ptr<MockObjects::InertSensor> sensor;
+    std::shared_ptr<Toaster>                  toaster;
+    std::uint64_t                             sent{0};
+    bool                                      door_open{false};
+
+    // Timer expirations are handled too, which only ever makes this a bit optimistic
+    std::int64_t in_flight() const
+    {
+        return static_cast<std::int64_t>(sent) -
+               static_cast<std::int64_t>(toaster->m_metrics.dispatched());
+    }
+};
+
+struct GeneratorResult
+{
+    std::uint64_t sent[kind_count]{};
+    std::uint64_t dropped{0};
+    std::uint64_t restarts{0};
+    double        max_lag_ms{0.0};  // Open mode, how late the generator got on its schedule
+};
+
+bool parse(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--toasters") == 0)
+        {
+            options.toasters = std::max(1, atoi(value));
+        }
+        else if (strcmp(argv[i - 1], "--executor") == 0)
+        {
+            options.executor_threads = std::max(0, atoi(value));
+        }
+        else if (strcmp(argv[i - 1], "--threads") == 0)
+        {
+            options.threads = std::max(1, atoi(value));
+        }
+        else if (strcmp(argv[i - 1], "--mode") == 0)
+        {
+            if (strcmp(value, "open") != 0 && strcmp(value, "closed") != 0)
+            {
+                return false;
+            }
+            options.closed = strcmp(value, "closed") == 0;
+        }
+        else if (strcmp(argv[i - 1], "--rate") == 0)
+        {
+            options.rate = std::max(1.0, atof(value));
+        }
+        else if (strcmp(argv[i - 1], "--concurrency") == 0)
+        {
+            options.concurrency = std::max(1, atoi(value));
+        }
+        else if (strcmp(argv[i - 1], "--duration") == 0)
+        {
+            options.duration = std::max(0.1, atof(value));
+        }
+        else if (strcmp(argv[i - 1], "--mix") == 0)
+        {
+            double *m = options.mix;
+            if (sscanf(value, "%lf,%lf,%lf,%lf,%lf", &m[0], &m[1], &m[2], &m[3], &m[4]) != 5 ||
+                std::any_of(m, m + kind_count, [](double w) { return w < 0; }) ||
+                std::all_of(m, m + kind_count, [](double w) { return w == 0; }))
+            {
+                return false;
+            }
+        }
+        else if (strcmp(argv[i - 1], "--queue-limit") == 0)
+        {
+            options.queue_limit = std::max(1, atoi(value));
+        }
+        else
+        {
+            return false;
+        }
+    }
+    options.threads = std::min(options.threads, options.toasters);
+    return true;
+}
+
+/* Waits for the toaster to run the evt_stop, then starts it again. Giving up earlier would leave
+that evt_stop queued, to stop the restarted toaster */
+void restart(Toaster &toaster)
+{
+    while (toaster.m_running)
+        std::this_thread::yield();
+    toaster.stop();
+    toaster.start();
+}
+
+void send(Target &target, Kind kind, GeneratorResult &result)
+{
+    switch (kind)
+    {
+        case toast:
+            target.toaster->put_external_entity_event(ExternalEntityEvtType::toast_request);
+            break;
+        case bake:
+            target.toaster->put_external_entity_event(ExternalEntityEvtType::bake_request);
+            break;
+        case door:
+            target.toaster->put_external_entity_event(target.door_open
+                                                          ? ExternalEntityEvtType::closing_door
+                                                          : ExternalEntityEvtType::opening_door);
+            target.door_open = !target.door_open;
+            break;
+        case stop:
+            target.toaster->put_external_entity_event(ExternalEntityEvtType::stop_request);
+            break;
+        case sensor:
+        default:
+        {
+            static const TempSensorEvtType readings[] = {TempSensorEvtType::temp_below_target,
+                                                         TempSensorEvtType::target_temp_reached,
+                                                         TempSensorEvtType::temp_above_target};
+            target.sensor->publish(readings[target.sent % 3]);
+            break;
+        }
+    }
+    target.sent++;
+    result.sent[kind]++;
+    if (kind == stop)
+    {
+        restart(*target.toaster);
+        result.restarts++;
+    }
+}
+
+// Puts an event of a random kind to target, unless its queue is over the limit
+void offer(Target &target, Kind kind, const Options &options, GeneratorResult &result)
+{
+    if (target.in_flight() >= options.queue_limit)
+    {
+        result.dropped++;
+        return;
+    }
+    send(target, kind, result);
+}
+
+void generate(const Options &options, std::vector<Target *> targets, clock_type::time_point end,
+              unsigned seed, GeneratorResult &result)
+{
+    std::mt19937                               rng{seed};
+    std::discrete_distribution<int>            pick_kind(options.mix, options.mix + kind_count);
+    std::uniform_int_distribution<std::size_t> pick_target(0, targets.size() - 1);
+
+    if (options.closed)
+    {
+        // Tops every toaster up to its concurrency, yields when they are all full
+        while (clock_type::now() < end)
+        {
+            bool sent = false;
+            for (Target *target : targets)
+                if (target->in_flight() < options.concurrency)
+                {
+                    send(*target, static_cast<Kind>(pick_kind(rng)), result);
+                    sent = true;
+                }
+            if (!sent)
+            {
+                std::this_thread::yield();
+            }
+        }
+        return;
+    }
+
+    // Exponential inter-arrival times, this generator's share of the rate
+    const double share =
+        options.rate * static_cast<double>(targets.size()) / static_cast<double>(options.toasters);
+    std::exponential_distribution<double> interval(share);
+    auto                                  due = clock_type::now();
+    while (due < end)
+    {
+        due += std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(interval(rng)));
+        const auto now = clock_type::now();
+        if (due > now)
+        {
+            std::this_thread::sleep_until(due);
+        }
+        else
+        {
+            // Late, the event goes right away: the schedule, not the fleet, sets the rate
+            result.max_lag_ms = std::max(
+                result.max_lag_ms, std::chrono::duration<double, std::milli>(now - due).count());
+        }
+        offer(*targets[pick_target(rng)], static_cast<Kind>(pick_kind(rng)), options, result);
+    }
+}
+
+void usage(const char *program)
+{
+    std::cerr << "Usage: " << program
+              << " [--toasters N] [--executor N] [--threads N] [--mode open|closed] [--rate R]"
+                 " [--concurrency C] [--duration S] [--mix T,B,D,S,X] [--queue-limit L]"
+              << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse(argc, argv, options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    boost::asio::io_context ioc;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work;
+    std::vector<std::thread> runners;
+
+    std::vector<Target> targets(options.toasters);
+    for (Target &target : targets)
+    {
+        target.sensor = std::make_shared<MockObjects::InertSensor>();
+        auto heater   = std::make_shared<MockObjects::InertHeater>();
+        target.toaster =
+            options.executor_threads > 0
+                ? std::make_shared<Toaster>(ioc, heater, target.sensor)
+                : std::make_shared<Toaster>(heater, target.sensor);
+        target.toaster->m_trace.set_enabled(false);
+        target.toaster->start();
+    }
+    if (options.executor_threads > 0)
+    {
+        work.emplace(ioc.get_executor());
+        for (int i = 0; i < options.executor_threads; i++)
+            runners.emplace_back([&ioc]() { ioc.run(); });
+    }
+
+    const auto load = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(options.duration));
+    std::vector<GeneratorResult> results(options.threads);
+    std::vector<std::thread>     generators;
+    const auto                   started = clock_type::now();
+    const auto                   end     = started + load;
+    for (int g = 0; g < options.threads; g++)
+    {
+        std::vector<Target *> owned;
+        for (int i = g; i < options.toasters; i += options.threads)
+            owned.push_back(&targets[i]);
+        generators.emplace_back(generate, std::cref(options), std::move(owned), end,
+                                static_cast<unsigned>(g + 1), std::ref(results[g]));
+    }
+    for (auto &generator : generators)
+        generator.join();
+    const double elapsed = std::chrono::duration<double>(clock_type::now() - started).count();
+
+    // The fleet gets a second to drain what is still queued
+    const auto drain_deadline = clock_type::now() + std::chrono::seconds(1);
+    while (clock_type::now() < drain_deadline &&
+           std::any_of(targets.begin(), targets.end(),
+                       [](const Target &target) { return target.in_flight() > 0; }))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    GeneratorResult total;
+    for (const GeneratorResult &result : results)
+    {
+        for (int k = 0; k < kind_count; k++)
+            total.sent[k] += result.sent[k];
+        total.dropped += result.dropped;
+        total.restarts += result.restarts;
+        total.max_lag_ms = std::max(total.max_lag_ms, result.max_lag_ms);
+    }
+    std::uint64_t         sent    = 0;
+    std::uint64_t         handled = 0;
+    std::uint64_t         alarms  = 0;
+    tao::LatencyHistogram latency;
+    for (const Target &target : targets)
+    {
+        sent += target.sent;
+        const tao::MetricsSnapshot snapshot = target.toaster->m_metrics.snapshot();
+        handled += snapshot.dispatch.count;
+        alarms += snapshot.event(tao::InternalEvent::evt_alarm_timeout).count;
+        for (std::size_t b = 0; b < tao::LatencyHistogram::bucket_count; b++)
+            latency.counts[b] += snapshot.dispatch.latency.counts[b];
+    }
+    handled -= std::min(handled, alarms);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << (options.closed ? "closed" : "open") << " loop, " << options.toasters
+              << " toasters ("
+              << (options.executor_threads > 0
+                      ? std::to_string(options.executor_threads) + " executor threads"
+                      : std::string("a thread each"))
+              << "), " << options.threads << " generator threads, " << elapsed << " s";
+    if (options.closed)
+    {
+        std::cout << ", " << options.concurrency << " in flight per toaster" << std::endl;
+    }
+    else
+    {
+        std::cout << ", target " << options.rate << " events/s" << std::endl;
+    }
+    std::cout << "sent     " << sent << " (";
+    for (int k = 0; k < kind_count; k++)
+        std::cout << (k ? ", " : "") << kind_names[k] << " " << total.sent[k];
+    std::cout << ")" << std::endl;
+    std::cout << "handled  " << handled << ", still queued " << (sent - std::min(sent, handled))
+              << ", timer expirations " << alarms << ", restarts " << total.restarts << std::endl;
+    std::cout << "dropped  " << total.dropped << " (queue limit " << options.queue_limit << ")"
+              << std::endl;
+    std::cout << "throughput " << static_cast<double>(handled) / elapsed << " events/s";
+    if (!options.closed)
+    {
+        std::cout << ", generator at most " << total.max_lag_ms << " ms behind schedule";
+    }
+    std::cout << std::endl;
+    std::cout << "latency (us, enqueue to transition) p50 " << latency.percentile(0.5) / 1000.0
+              << ", p90 " << latency.percentile(0.9) / 1000.0 << ", p99 "
+              << latency.percentile(0.99) / 1000.0 << ", p99.9 "
+              << latency.percentile(0.999) / 1000.0 << std::endl;
+
+    for (Target &target : targets)
+        target.toaster->stop();
+    // Armed alarm timers would keep run() going, their handlers bail out anyway
+    work.reset();
+    ioc.stop();
+    for (auto &runner : runners)
+        runner.join();
+    return 0;
+}
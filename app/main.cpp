@@ -1,34 +1,164 @@
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "IngestionServer.hpp"
+#include "MetricsExporter.hpp"
 #include "ToasterActiveObject.hpp"
+#include "ToasterSnapshot.hpp"
 
+// Set up by main(), for sigint_handler to leave a snapshot of the fleet behind
+static std::vector<std::shared_ptr<Toaster>> g_toasters;
+static std::unique_ptr<tao::SnapshotFile>    g_snapshots;
 
 void sigint_handler(int sig)
 {
     printf("[sigint_handler] Will exit cleanly...\n");
+    if (g_snapshots)
+    {
+        // Stopped first, so that nothing moves while the snapshots are taken
+        for (auto &toaster : g_toasters)
+            toaster->stop();
+        for (std::size_t i = 0; i < g_toasters.size(); i++)
+            (*g_snapshots)[i] = g_toasters[i]->snapshot();
+        g_snapshots->sync();
+        printf("[sigint_handler] Fleet snapshot written\n");
+    }
     exit(0);
 }
 
 int main(int argc, char **argv)
 {
-    /* Binds the SIGINT signal to my custom handler */
+    /* Binds the SIGINT signal to my custom handler. Blocked in every thread started until the
+    fleet is up, so that it is handled by this one: the handler joins the toaster threads */
     signal(SIGINT, sigint_handler);
+    sigset_t sigint;
+    sigemptyset(&sigint);
+    sigaddset(&sigint, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint, nullptr);
+
+    /* Options:
+        --toasters N           fleet size, toaster 0 is the one std::cin commands go to
+        --metrics-port N       Prometheus endpoint on localhost
+        --metrics-socket PATH  Prometheus endpoint on a Unix domain socket
+        --journal DIRECTORY    event journal of the whole fleet
+        --snapshot FILE        fleet restored from FILE at startup, saved to it on SIGINT
+        --ingest-socket PATH   takes framed commands for the fleet instead of std::cin */
+    int         toaster_count  = 1;
+    const char *metrics_socket = nullptr;
+    int         metrics_port   = -1;
+    const char *journal_path   = nullptr;
+    const char *snapshot_path  = nullptr;
+    const char *ingest_path    = nullptr;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--toasters") == 0)
+        {
+            toaster_count = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--metrics-port") == 0)
+        {
+            metrics_port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--metrics-socket") == 0)
+        {
+            metrics_socket = argv[++i];
+        }
+        else if (strcmp(argv[i], "--journal") == 0)
+        {
+            journal_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--snapshot") == 0)
+        {
+            snapshot_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--ingest-socket") == 0)
+        {
+            ingest_path = argv[++i];
+        }
+    }
+
+    std::vector<std::shared_ptr<Toaster>> &toasters = g_toasters;
+    for (int i = 0; i < toaster_count; i++)
+    {
+        auto thermal_state = std::make_shared<DemoObjects::ThermalState>();
+        toasters.push_back(std::make_shared<Toaster>(
+            std::make_shared<DemoObjects::HeaterDemo>(thermal_state),
+            std::make_shared<DemoObjects::TempSensorDemo>(thermal_state)));
+    }
+
+    if (journal_path != nullptr)
+    {
+        auto journal = std::make_shared<EventJournal>(journal_path, "toaster");
+        for (int i = 0; i < toaster_count; i++)
+            toasters[i]->set_journal(journal, static_cast<std::uint32_t>(i));
+    }
+
+    std::unique_ptr<MetricsExporter> exporter;
+    if (metrics_socket != nullptr)
+    {
+        exporter = std::make_unique<MetricsExporter>(
+            MetricsExporter::Endpoint::unix_socket(metrics_socket));
+    }
+    else if (metrics_port >= 0)
+    {
+        exporter = std::make_unique<MetricsExporter>(
+            MetricsExporter::Endpoint::tcp(static_cast<std::uint16_t>(metrics_port)));
+    }
+    if (exporter)
+    {
+        for (int i = 0; i < toaster_count; i++)
+            exporter->add_toaster(toaster_count == 1 ? "toaster" : "toaster" + std::to_string(i),
+                                  toasters[i]);
+        exporter->start();
+        if (exporter->port() != 0)
+            printf("[main] Serving metrics on 127.0.0.1:%u\n", exporter->port());
+    }
 
-    auto toaster = std::make_shared<Toaster>(std::make_shared<DemoObjects::HeaterDemo>(),
-                                             std::make_shared<DemoObjects::TempSensorDemo>());
+    if (snapshot_path != nullptr)
+    {
+        // Empty slots (a new file, or a toaster never snapshotted) leave their toaster as it is
+        g_snapshots = std::make_unique<tao::SnapshotFile>(snapshot_path, toaster_count);
+        for (int i = 0; i < toaster_count; i++)
+            if (toasters[i]->restore((*g_snapshots)[i]))
+                printf("[main] Toaster %d restored in %s\n", i,
+                       stringify(toasters[i]->m_state->type()).c_str());
+    }
 
-    toaster->start();
+    for (auto &toaster : toasters)
+        toaster->start();
+
+    std::unique_ptr<IngestionServer> ingestion;
+    if (ingest_path != nullptr)
+    {
+        ingestion = std::make_unique<IngestionServer>(ingest_path);
+        for (auto &toaster : toasters)
+            ingestion->add_toaster(toaster);
+        ingestion->start();
+        printf("[main] Taking commands for %d toasters on %s\n", toaster_count, ingest_path);
+    }
+    pthread_sigmask(SIG_UNBLOCK, &sigint, nullptr);
+
+    if (ingestion)
+    {
+        while (true)
+            pause();
+    }
 
     while (true)
     {
         int k = 0;
         std::cin >> k;
         std::cout << "---------------------------" << std::endl;
-        toaster->put_external_entity_event(static_cast<ExternalEntityEvtType>(k));
+        toasters[0]->put_external_entity_event(static_cast<ExternalEntityEvtType>(k));
         std::cout << "---------------------------" << std::endl;
     }
 
@@ -0,0 +1,36 @@
+#include <fstream>
+#include <iostream>
+
+#include "TraceReplay.hpp"
+
+/* Converts a CSV temperature trace ("offset_ms,temperature" per line) into the binary format
+replayed by TraceReplay::TraceReplaySensor */
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.csv> <output.trace>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in)
+    {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const auto records = TraceReplay::parse_csv(in);
+        TraceReplay::write_trace(argv[2], records);
+        std::cout << "Wrote " << records.size() << " records to " << argv[2] << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -30,7 +30,7 @@ function print_help()
     -v, --verbose       [v]erbose
 
     targets:
-     <target> is a positional argument. Either "app" of "test"
+     <target> is a positional argument. Either "app", "test" or "benchmarks"
 EOF
 
     return 0
@@ -105,7 +105,13 @@ function func_build()
 {
     print_banner "Building code"
 
-    cmake -S . -B build -D TARGET_GROUP=$1
+    # Benchmarks are only worth running optimized
+    local build_type=""
+    if [[ "$1" == "benchmarks" ]]; then
+        build_type="-D CMAKE_BUILD_TYPE=Release"
+    fi
+
+    cmake -S . -B build -D TARGET_GROUP=$1 $build_type
     cmake --build build --parallel `nproc`
 
 }
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CompactFleet.hpp"
+#include "MockObjects.hpp"
+
+/* Footprint of idle toasters, Toaster (executor mode, every toaster on one shared io_context)
+against CompactFleet. Counters give sizeof() and the resident memory each instance adds to the
+process (bytes, VmRSS delta over the count), plus the throughput of a fleet under load. */
+
+namespace
+{
+
+// A field of /proc/self/status (Threads, VmRSS in kB...), 0 when it can't be read
+long proc_status(const std::string &field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string   line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+        {
+            return std::stol(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
+
+// Resident memory right now, once the heap gave back what earlier runs freed
+long rss_kb_now()
+{
+    malloc_trim(0);
+    return proc_status("VmRSS");
+}
+
+}  // namespace
+
+static void BM_CompactFleetFootprint(benchmark::State &state)
+{
+    const long count  = state.range(0);
+    long       rss_kb = 0;
+    for (auto _ : state)
+    {
+        const long   before = rss_kb_now();
+        CompactFleet fleet(static_cast<std::size_t>(count));
+        rss_kb = proc_status("VmRSS") - before;
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["sizeof"]       = static_cast<double>(sizeof(CompactToaster));
+    state.counters["rss_per_inst"] = static_cast<double>(rss_kb) * 1024 / count;
+}
+BENCHMARK(BM_CompactFleetFootprint)
+    ->ArgName("toasters")
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_ToasterFootprint(benchmark::State &state)
+{
+    const long count  = state.range(0);
+    long       rss_kb = 0;
+    for (auto _ : state)
+    {
+        boost::asio::io_context               ioc;
+        std::vector<std::unique_ptr<Toaster>> toasters;
+        toasters.reserve(count);
+        const long before = rss_kb_now();
+        for (long i = 0; i < count; i++)
+            toasters.push_back(std::make_unique<Toaster>(
+                ioc, std::make_shared<MockObjects::InertHeater>(),
+                std::make_shared<MockObjects::InertSensor>()));
+        rss_kb = proc_status("VmRSS") - before;
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["sizeof"]       = static_cast<double>(sizeof(Toaster));
+    state.counters["rss_per_inst"] = static_cast<double>(rss_kb) * 1024 / count;
+}
+BENCHMARK(BM_ToasterFootprint)
+    ->ArgName("toasters")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+/* Sensor readings spread over every toaster of a started fleet, put by the benchmark thread and
+handled by the workers. Each iteration waits for the fleet to be done with its batch */
+static void BM_CompactFleetEvents(benchmark::State &state)
+{
+    constexpr CompactFleet::Handle count = 100000;
+    constexpr int                  batch = 4096;
+    CompactFleet fleet(count, static_cast<std::size_t>(state.range(0)));
+    fleet.start();
+    CompactFleet::Handle next = 0;
+    for (auto _ : state)
+    {
+        const std::uint64_t target = fleet.dispatched() + batch;
+        for (int i = 0; i < batch; i++)
+        {
+            fleet.put_temp_sensor_event(next, (i & 1) ? TempSensorEvtType::temp_above_target
+                                                      : TempSensorEvtType::temp_below_target);
+            next = (next + 1) % count;
+        }
+        while (fleet.dispatched() < target)
+            std::this_thread::yield();
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    fleet.stop();
+}
+BENCHMARK(BM_CompactFleetEvents)->ArgName("workers")->Arg(1)->Arg(2)->UseRealTime();
@@ -0,0 +1,300 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoostDeadlineTimer.hpp"
+#include "ToasterMetrics.hpp"
+
+/* How DeadlineTimer scales with the number of timers, for both of its backends:
+
+    dedicated - one io_service and one thread per timer, capped at 1024 timers
+    shared    - every timer on the executor of a single io_context, run by one thread
+
+Counters give the threads and resident memory of the process once the timers exist, so numbers
+can be compared against any future timer backend. */
+
+namespace
+{
+
+enum Backend
+{
+    dedicated,
+    shared,
+};
+
+constexpr long max_dedicated = 1024;
+
+std::int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// A field of /proc/self/status (Threads, VmRSS in kB...), 0 when it can't be read
+long proc_status(const std::string &field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string   line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+        {
+            return std::stol(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
+
+// Shared io_context and its runner thread, stopped before the timers go away
+class Context
+{
+   public:
+    explicit Context(bool run)
+    {
+        if (run)
+        {
+            m_thread = std::thread([this]() { m_ioc.run(); });
+        }
+    }
+    ~Context()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        m_work.reset();
+        m_ioc.stop();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    boost::asio::io_context &ioc()
+    {
+        return m_ioc;
+    }
+
+   private:
+    boost::asio::io_context m_ioc;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_work{
+        m_ioc.get_executor()};
+    std::thread m_thread;
+};
+
+std::unique_ptr<DeadlineTimer> make_timer(Backend backend, Context &context, long period,
+                                          std::function<void(void)> cb, bool cyclic)
+{
+    if (backend == dedicated)
+    {
+        return std::make_unique<DeadlineTimer>(period, std::move(cb), cyclic);
+    }
+    return std::make_unique<DeadlineTimer>(context.ioc().get_executor(), period, std::move(cb),
+                                           cyclic);
+}
+
+// Half of the timers are cyclic, periods spread between 5 and 50 ms
+bool is_cyclic(long i)
+{
+    return i % 2 == 0;
+}
+long period_of(long i)
+{
+    return 5 + (i * 7) % 46;
+}
+
+/* Expirations can come from as many threads as there are dedicated timers, so the buckets of
+the histogram are atomics */
+struct LatenessHistogram
+{
+    void add(std::int64_t ns)
+    {
+        const auto clamped = static_cast<std::uint32_t>(std::min<std::int64_t>(
+            std::max<std::int64_t>(ns, 0), std::numeric_limits<std::uint32_t>::max()));
+        counts[tao::LatencyHistogram::bucket_of(clamped)].fetch_add(1, std::memory_order_relaxed);
+    }
+    tao::LatencyHistogram load() const
+    {
+        tao::LatencyHistogram result;
+        for (std::size_t b = 0; b < tao::LatencyHistogram::bucket_count; b++)
+            result.counts[b] = counts[b].load(std::memory_order_relaxed);
+        return result;
+    }
+
+    std::array<std::atomic<std::uint64_t>, tao::LatencyHistogram::bucket_count> counts{};
+};
+
+// When the next expiration of a timer is due, kept up to date by its own callback
+struct Probe
+{
+    std::atomic<std::int64_t> due_ns{0};
+    long                      period_ms{0};
+};
+
+}  // namespace
+
+/* Construction and destruction of count timers. Reported per timer (items), with the threads and
+resident memory (kB) of the process while they all exist */
+template <Backend backend>
+static void BM_TimerConstruction(benchmark::State &state)
+{
+    const long                                  count = state.range(0);
+    std::vector<std::unique_ptr<DeadlineTimer>> timers;
+    timers.reserve(count);
+    long threads = 0;
+    long rss_kb  = 0;
+
+    for (auto _ : state)
+    {
+        Context context{backend == shared};
+        for (long i = 0; i < count; i++)
+            timers.push_back(make_timer(backend, context, period_of(i), []() {}, is_cyclic(i)));
+
+        state.PauseTiming();
+        threads = proc_status("Threads");
+        rss_kb  = proc_status("VmRSS");
+        context.stop();
+        state.ResumeTiming();
+
+        timers.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["threads"] = static_cast<double>(threads);
+    state.counters["rss_kb"]  = static_cast<double>(rss_kb);
+}
+BENCHMARK_TEMPLATE(BM_TimerConstruction, dedicated)
+    ->ArgName("timers")
+    ->RangeMultiplier(10)
+    ->Range(1, 1000)
+    ->Arg(max_dedicated)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_TimerConstruction, shared)
+    ->ArgName("timers")
+    ->RangeMultiplier(10)
+    ->Range(1, 100000)
+    ->Unit(benchmark::kMicrosecond);
+
+/* start() followed by stop(), round robin over count timers. The shared context is polled by the
+benchmark thread itself, dedicated timers run the aborted waits on their own threads */
+template <Backend backend>
+static void BM_TimerArmCancel(benchmark::State &state)
+{
+    const long                                  count = state.range(0);
+    Context                                     context{false};
+    std::vector<std::unique_ptr<DeadlineTimer>> timers;
+    for (long i = 0; i < count; i++)
+        timers.push_back(make_timer(backend, context, 1000, []() {}, false));
+
+    long i = 0;
+    for (auto _ : state)
+    {
+        DeadlineTimer &timer = *timers[i % count];
+        timer.start();
+        timer.stop();
+        if (backend == shared && ++i % 1024 == 0)
+        {
+            // Runs the aborted waits, they would pile up otherwise
+            context.ioc().poll();
+        }
+        else if (backend == dedicated)
+        {
+            i++;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    context.ioc().poll();
+    context.stop();
+}
+BENCHMARK_TEMPLATE(BM_TimerArmCancel, dedicated)->ArgName("timers")->Arg(1)->Arg(max_dedicated);
+BENCHMARK_TEMPLATE(BM_TimerArmCancel, shared)->ArgName("timers")->Arg(1)->Arg(1000)->Arg(100000);
+
+/* count timers, half cyclic and half one-shot, run for 300 ms. Lateness of every expiration
+compared to its deadline, in nanoseconds (bucket upper bounds) */
+template <Backend backend>
+static void BM_TimerLateness(benchmark::State &state)
+{
+    const long         count = state.range(0);
+    LatenessHistogram  lateness;
+    std::atomic<long>  expirations{0};
+    std::vector<Probe> probes(count);
+
+    for (auto _ : state)
+    {
+        Context                                     context{backend == shared};
+        std::vector<std::unique_ptr<DeadlineTimer>> timers;
+        timers.reserve(count);
+        for (long i = 0; i < count; i++)
+        {
+            Probe &probe    = probes[i];
+            probe.period_ms = period_of(i);
+            timers.push_back(make_timer(
+                backend, context, probe.period_ms,
+                [&probe, &lateness, &expirations]()
+                {
+                    const std::int64_t now = now_ns();
+                    lateness.add(now - probe.due_ns.load(std::memory_order_relaxed));
+                    // A cyclic timer is armed again right after its callback returns
+                    probe.due_ns.store(now + probe.period_ms * 1000000, std::memory_order_relaxed);
+                    expirations.fetch_add(1, std::memory_order_relaxed);
+                },
+                is_cyclic(i)));
+        }
+
+        // With the shared backend, start() must not race the runner: arm them all from it
+        auto arm_all = [&]()
+        {
+            for (long i = 0; i < count; i++)
+            {
+                probes[i].due_ns.store(now_ns() + probes[i].period_ms * 1000000,
+                                       std::memory_order_relaxed);
+                timers[i]->start();
+            }
+        };
+        if (backend == shared)
+        {
+            boost::asio::post(context.ioc(), arm_all);
+        }
+        else
+        {
+            arm_all();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        state.counters["threads"] = static_cast<double>(proc_status("Threads"));
+        state.counters["rss_kb"]  = static_cast<double>(proc_status("VmRSS"));
+        context.stop();
+        timers.clear();
+    }
+
+    const tao::LatencyHistogram merged = lateness.load();
+    state.counters["expirations"]      = static_cast<double>(expirations.load());
+    state.counters["p50_ns"]           = static_cast<double>(merged.percentile(0.5));
+    state.counters["p99_ns"]           = static_cast<double>(merged.percentile(0.99));
+    state.counters["p999_ns"]          = static_cast<double>(merged.percentile(0.999));
+}
+BENCHMARK_TEMPLATE(BM_TimerLateness, dedicated)
+    ->ArgName("timers")
+    ->Arg(10)
+    ->Arg(max_dedicated)
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TimerLateness, shared)
+    ->ArgName("timers")
+    ->Arg(10)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
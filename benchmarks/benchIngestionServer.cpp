@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IngestionServer.hpp"
+#include "MockObjects.hpp"
+
+/* Commands per second through the ingestion server: clients writing frames as fast as the socket
+takes them, to toasters running on inert mocks. An iteration is a burst of frames from every
+client, done once each toaster stepped through its share. */
+
+namespace
+{
+
+constexpr int frames_per_client = 4096;
+
+int connect_to(const std::string &path)
+{
+    int         fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void write_all(int fd, const char *data, std::size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t written = ::write(fd, data, size);
+        if (written <= 0)
+        {
+            return;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+}  // namespace
+
+static void BM_IngestionThroughput(benchmark::State &state)
+{
+    const int         clients  = static_cast<int>(state.range(0));
+    const int         toasters = static_cast<int>(state.range(1));
+    const std::string path = "/tmp/benchIngestionServer." + std::to_string(getpid()) + ".sock";
+
+    std::vector<std::shared_ptr<Toaster>> fleet;
+    IngestionServer                       server{path};
+    for (int t = 0; t < toasters; t++)
+    {
+        fleet.push_back(std::make_shared<Toaster>(std::make_shared<MockObjects::InertHeater>(),
+                                                  std::make_shared<MockObjects::InertSensor>()));
+        fleet.back()->start();
+        server.add_toaster(fleet.back());
+    }
+    server.start();
+
+    // Sensor readings keep the toasters in heating, round robin over the fleet
+    const std::uint16_t reading =
+        tao::IncomingEventWrapper{TempSensorEvent{TempSensorEvtType::temp_below_target}}.encode();
+    std::vector<char> burst(frames_per_client * IngestionServer::frame_size);
+    for (int i = 0; i < frames_per_client; i++)
+        IngestionServer::write_frame(&burst[i * IngestionServer::frame_size],
+                                     static_cast<std::uint32_t>(i % toasters), reading);
+
+    std::vector<int> fds;
+    for (int c = 0; c < clients; c++)
+        fds.push_back(connect_to(path));
+
+    std::uint64_t expected = 0;
+    for (auto _ : state)
+    {
+        std::vector<std::thread> writers;
+        for (int fd : fds)
+            writers.emplace_back([fd, &burst]() { write_all(fd, burst.data(), burst.size()); });
+        for (auto &writer : writers)
+            writer.join();
+
+        expected += static_cast<std::uint64_t>(frames_per_client) * clients;
+        std::uint64_t stepped = 0;
+        while (stepped < expected)
+        {
+            stepped = 0;
+            for (const auto &toaster : fleet)
+                stepped += toaster->m_trace.recorded();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * frames_per_client * clients);
+    state.counters["batches"] = static_cast<double>(server.stats().batches);
+
+    for (int fd : fds)
+        ::close(fd);
+    server.stop();
+    for (auto &toaster : fleet)
+        toaster->stop();
+}
+BENCHMARK(BM_IngestionThroughput)
+    ->ArgNames({"clients", "toasters"})
+    ->Args({1, 1})
+    ->Args({4, 16})
+    ->Args({16, 64})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
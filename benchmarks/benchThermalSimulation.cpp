@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+#include <malloc.h>
+#include <fstream>
+#include <string>
+
+#include "ThermalSimulation.hpp"
+
+namespace
+{
+
+// Resident memory in kB, once the heap gave back what earlier runs freed
+long rss_kb_now()
+{
+    malloc_trim(0);
+    std::ifstream status("/proc/self/status");
+    std::string   line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+/* A fleet of slots stepped on the calling thread, each slot a thermostat: its crossings turn the
+heater on below the target and off above it, so the fleet keeps producing sensor events. Items are
+slots stepped, "event_cost" the time per crossing delivered (stepping included) and "bytes_per_slot"
+the resident memory each slot adds to the process */
+static void BM_FleetEngineTick(benchmark::State &state)
+{
+    const auto  count  = static_cast<std::size_t>(state.range(0));
+    const long  before = rss_kb_now();
+    std::size_t events = 0;
+
+    ThermalSimulation::FleetEngine engine(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const auto slot = engine.add_slot();
+        engine.set_target_temperature(slot, 30.0f + static_cast<float>(i % 40));
+        engine.set_heater(slot, i % 2 == 0);
+    }
+    engine.set_crossings_handler(
+        [&](const ThermalSimulation::Crossing *crossings, std::size_t n)
+        {
+            for (std::size_t i = 0; i < n; i++)
+            {
+                if (crossings[i].event == TempSensorEvtType::temp_below_target)
+                    engine.set_heater(crossings[i].slot, true);
+                else if (crossings[i].event == TempSensorEvtType::temp_above_target)
+                    engine.set_heater(crossings[i].slot, false);
+            }
+            events += n;
+        });
+    const long rss_kb = rss_kb_now() - before;
+
+    for (auto _ : state)
+    {
+        engine.tick();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(count));
+    state.counters["events_per_tick"] =
+        static_cast<double>(events) / static_cast<double>(state.iterations());
+    state.counters["event_cost"] = benchmark::Counter(
+        static_cast<double>(events), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["bytes_per_slot"] = static_cast<double>(rss_kb) * 1024 / count;
+}
+BENCHMARK(BM_FleetEngineTick)->ArgName("slots")->Arg(100000)->Unit(benchmark::kMicrosecond);
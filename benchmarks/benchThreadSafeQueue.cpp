@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "ThreadSafeQueue.hpp"
+#include "ToasterActiveObject.hpp"
+
+/* Throughput and put() latency of the IThreadSafeQueue implementations. Google Benchmark runs
+the body on every thread with the same iteration count, each thread gets a role from its index:
+
+    SPSC - 1 producer, 1 consumer (a single thread puts then pops)
+    MPSC - n - 1 producers, 1 consumer popping n - 1 elements per iteration
+    MPMC - n / 2 producers, n / 2 consumers
+
+Every 8th put() is timed into a LatencyHistogram per thread, merged into the p50 / p99 / p99.9
+counters (nanoseconds, bucket upper bounds) once all threads are done. With prioritized set, one
+put() out of 4 is a put_prioritized(). */
+
+namespace
+{
+
+enum Topology
+{
+    spsc,
+    mpsc,
+    mpmc,
+};
+
+constexpr int     max_threads   = 32;
+constexpr int     sampling_mask = 7;
+constexpr int     priority_mask = 3;
+const std::string string_payload(48, 'x');  // Too long for the small string optimization
+
+int make_payload(int value, int *)
+{
+    return value;
+}
+std::string make_payload(int, std::string *)
+{
+    return string_payload;
+}
+tao::IncomingEventWrapper make_payload(int value, tao::IncomingEventWrapper *)
+{
+    return (value & 1) ? tao::IncomingEventWrapper{TempSensorEvent{
+                             TempSensorEvtType::temp_below_target}}
+                       : tao::IncomingEventWrapper{ExternalEntityEvent{
+                             ExternalEntityEvtType::toast_request}};
+}
+
+template <class Queue>
+struct Shared
+{
+    static inline std::unique_ptr<Queue>                         queue;
+    static inline std::array<tao::LatencyHistogram, max_threads> latencies;
+};
+
+template <class Queue>
+void timed_put(Queue &queue, int i, bool prioritized, tao::LatencyHistogram &latency)
+{
+    using T   = typename Queue::value_type;
+    T element = make_payload(i, static_cast<T *>(nullptr));
+    if ((i & sampling_mask) != 0)
+    {
+        prioritized ? queue.put_prioritized(std::move(element)) : queue.put(std::move(element));
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    prioritized ? queue.put_prioritized(std::move(element)) : queue.put(std::move(element));
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    latency.add(static_cast<std::uint32_t>(ns));
+}
+
+}  // namespace
+
+template <class Queue, Topology topology>
+static void BM_Queue(benchmark::State &state)
+{
+    using shared = Shared<Queue>;
+
+    const bool mix       = state.range(0) != 0;
+    const int  threads   = state.threads();
+    const int  index     = state.thread_index();
+    const int  consumers = threads == 1 ? 0 : (topology == mpmc ? threads / 2 : 1);
+    const int  producers = threads - consumers;
+    const bool producer  = index >= consumers;
+
+    if (index == 0)
+    {
+        shared::queue = std::make_unique<Queue>();
+        for (auto &latency : shared::latencies)
+            latency = tao::LatencyHistogram{};
+    }
+
+    // Threads only meet at the start of the loop, the queue can't be looked at before
+    tao::LatencyHistogram &latency = shared::latencies[index];
+    int                    i       = 0;
+    for (auto _ : state)
+    {
+        Queue &queue = *shared::queue;
+        if (producer)
+        {
+            timed_put(queue, i, mix && (i & priority_mask) == 0, latency);
+            if (threads == 1)
+            {
+                benchmark::DoNotOptimize(queue.wait_and_pop());
+            }
+        }
+        else
+        {
+            for (int p = 0; p < producers / consumers; p++)
+                benchmark::DoNotOptimize(queue.wait_and_pop());
+        }
+        i++;
+    }
+
+    if (producer)
+    {
+        state.SetItemsProcessed(state.iterations());
+    }
+    // Every thread is out of the loop once thread 0 gets here
+    if (index == 0)
+    {
+        tao::LatencyHistogram merged;
+        for (const auto &each : shared::latencies)
+            for (std::size_t b = 0; b < tao::LatencyHistogram::bucket_count; b++)
+                merged.counts[b] += each.counts[b];
+        state.counters["put_p50_ns"]  = static_cast<double>(merged.percentile(0.5));
+        state.counters["put_p99_ns"]  = static_cast<double>(merged.percentile(0.99));
+        state.counters["put_p999_ns"] = static_cast<double>(merged.percentile(0.999));
+        shared::queue.reset();
+    }
+    state.SetLabel(mix ? "prioritized mix" : "");
+}
+
+// SPSC on 1 and 2 threads, MPSC and MPMC from 2 to 32, each with and without prioritized puts
+#define QUEUE_BENCHMARKS(Queue)                                                     \
+    BENCHMARK_TEMPLATE2(BM_Queue, Queue, spsc)                                      \
+        ->ArgName("prioritized")                                                    \
+        ->DenseRange(0, 1)                                                          \
+        ->Threads(1)                                                                \
+        ->Threads(2)                                                                \
+        ->UseRealTime();                                                            \
+    BENCHMARK_TEMPLATE2(BM_Queue, Queue, mpsc)                                      \
+        ->ArgName("prioritized")                                                    \
+        ->DenseRange(0, 1)                                                          \
+        ->ThreadRange(2, max_threads)                                               \
+        ->UseRealTime();                                                            \
+    BENCHMARK_TEMPLATE2(BM_Queue, Queue, mpmc)                                      \
+        ->ArgName("prioritized")                                                    \
+        ->DenseRange(0, 1)                                                          \
+        ->ThreadRange(2, max_threads)                                               \
+        ->UseRealTime()
+
+QUEUE_BENCHMARKS(SimplestThreadSafeQueue<int>);
+QUEUE_BENCHMARKS(SimplestThreadSafeQueue<std::string>);
+QUEUE_BENCHMARKS(SimplestThreadSafeQueue<tao::IncomingEventWrapper>);
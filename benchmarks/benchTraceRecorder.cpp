@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <sstream>
+
+#include "ToasterActiveObject.hpp"
+
+// Cost of a single record, alone
+static void BM_TraceRecorderRecord(benchmark::State &state)
+{
+    tao::TraceRecorder recorder;
+    auto               now = tao::TraceRecorder::clock::now();
+    for (auto _ : state)
+    {
+        recorder.record(tao::InternalEvent::evt_temp_below_target, tao::StateValue::STATE_HEATING,
+                        tao::StateValue::STATE_HEATING, now, now, 0);
+    }
+    benchmark::DoNotOptimize(recorder.recorded());
+}
+BENCHMARK(BM_TraceRecorderRecord);
+
+/* One run-to-completion step with the recorder on (range 1) and off (range 0), the difference
+being the overhead of the recording, clock readings included */
+static void BM_StateMachineStep(benchmark::State &state)
+{
+    auto thermal_state = std::make_shared<DemoObjects::ThermalState>();
+    Toaster toaster(std::make_shared<DemoObjects::HeaterDemo>(thermal_state),
+                    std::make_shared<DemoObjects::TempSensorDemo>(thermal_state));
+    toaster.m_trace.set_enabled(state.range(0) != 0);
+
+    for (auto _ : state)
+    {
+        toaster.state_machine_iteration(tao::InternalEvent::evt_temp_below_target);
+    }
+    state.SetLabel(state.range(0) ? "recording" : "not recording");
+}
+BENCHMARK(BM_StateMachineStep)->Arg(0)->Arg(1);
+
+static void BM_ChromeTraceExport(benchmark::State &state)
+{
+    tao::TraceRecorder recorder;
+    auto               now = tao::TraceRecorder::clock::now();
+    for (std::size_t i = 0; i < recorder.capacity(); i++)
+        recorder.record(tao::InternalEvent::evt_temp_below_target, tao::StateValue::STATE_HEATING,
+                        tao::StateValue::STATE_HEATING, now, now, 0);
+
+    for (auto _ : state)
+    {
+        std::ostringstream out;
+        tao::export_chrome_trace(out, recorder.snapshot());
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    state.SetItemsProcessed(state.iterations() * recorder.capacity());
+}
+BENCHMARK(BM_ChromeTraceExport);
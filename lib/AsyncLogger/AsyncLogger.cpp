@@ -0,0 +1,331 @@
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+#include "AsyncLogger.hpp"
+
+namespace AsyncLogger
+{
+
+namespace
+{
+constexpr std::size_t max_formats = 4096;
+// Last slot of the table, what records get once every other id was handed out
+constexpr std::size_t overflow_format = max_formats - 1;
+
+const char *level_names[] = {"debug", "info", "warning", "error", "off"};
+
+struct Format
+{
+    Level       level;
+    const char *component;
+    const char *format;
+};
+
+void stdout_sink(std::string_view lines)
+{
+    std::fwrite(lines.data(), 1, lines.size(), stdout);
+    std::fflush(stdout);
+}
+}  // namespace
+
+class Backend
+{
+   public:
+    // Never destroyed: threads may still log while static objects are being torn down
+    static Backend &instance()
+    {
+        static Backend *backend = new Backend;
+        return *backend;
+    }
+
+    format_id_t register_format(Level level, const char *component, const char *format)
+    {
+        std::scoped_lock<std::mutex> lock(m_formats_mutex);
+        const std::size_t            id = m_format_count.load(std::memory_order_relaxed);
+        if (id == overflow_format)
+        {
+            return static_cast<format_id_t>(overflow_format);
+        }
+        m_formats[id] = Format{level, component, format};
+        m_format_count.store(id + 1, std::memory_order_release);
+        return static_cast<format_id_t>(id);
+    }
+
+    Ring *create_ring()
+    {
+        auto ring = std::make_shared<Ring>(static_cast<std::uint32_t>(::syscall(SYS_gettid)));
+        std::scoped_lock<std::mutex> lock(m_rings_mutex);
+        m_rings.push_back(ring);
+        return ring.get();
+    }
+
+    void set_sink(Sink sink)
+    {
+        std::scoped_lock<std::mutex> lock(m_sink_mutex);
+        m_sink = sink ? std::move(sink) : Sink{stdout_sink};
+    }
+
+    void flush()
+    {
+        std::vector<std::pair<std::shared_ptr<Ring>, std::uint64_t>> pending;
+        bool                                                         stopped;
+        {
+            std::scoped_lock<std::mutex> lock(m_rings_mutex);
+            for (auto &ring : m_rings)
+                pending.emplace_back(ring, ring->m_head.load(std::memory_order_acquire));
+            stopped = m_stopped;
+        }
+        if (stopped)
+        {
+            // No background thread anymore, drain right here
+            drain();
+            return;
+        }
+        for (auto &[ring, head] : pending)
+        {
+            while (ring->m_tail.load(std::memory_order_acquire) < head)
+            {
+                m_wake.notify_one();
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    std::uint64_t dropped()
+    {
+        std::scoped_lock<std::mutex> lock(m_rings_mutex);
+        std::uint64_t                result = m_retired_dropped;
+        for (auto &ring : m_rings)
+            result += ring->m_dropped.load(std::memory_order_relaxed);
+        return result;
+    }
+
+   private:
+    Backend() : m_sink{stdout_sink}, m_thread{&Backend::run, this}
+    {
+        m_formats[overflow_format] =
+            Format{Level::error, "AsyncLogger", "Format table full, message not shown"};
+        // Whatever was logged before exit() still reaches the sink
+        std::atexit([]() { instance().stop(); });
+    }
+
+    void stop()
+    {
+        {
+            std::scoped_lock<std::mutex> lock(m_rings_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        drain();
+        std::scoped_lock<std::mutex> lock(m_rings_mutex);
+        m_stopped = true;
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            {
+                std::scoped_lock<std::mutex> lock(m_rings_mutex);
+                if (m_stop)
+                {
+                    return;
+                }
+            }
+            if (drain() == 0)
+            {
+                std::unique_lock<std::mutex> lock(m_rings_mutex);
+                if (!m_stop)
+                {
+                    m_wake.wait_for(lock, std::chrono::milliseconds(10));
+                }
+            }
+        }
+    }
+
+    /* Formats everything the rings hold into one batch for the sink. m_rings_mutex is only held
+    to copy the ring list and to drop retired rings, so new threads can get their ring meanwhile */
+    std::size_t drain()
+    {
+        std::scoped_lock<std::mutex> drain_lock(m_drain_mutex);
+        {
+            std::scoped_lock<std::mutex> lock(m_rings_mutex);
+            m_draining.assign(m_rings.begin(), m_rings.end());
+        }
+
+        std::size_t count = 0;
+        m_heads.clear();
+        m_buffer.clear();
+        for (auto &ring : m_draining)
+        {
+            const std::uint64_t head = ring->m_head.load(std::memory_order_acquire);
+            for (std::uint64_t i = ring->m_tail.load(std::memory_order_relaxed); i < head; i++)
+                format(ring->m_records[i % ring_capacity], ring->thread_id());
+            count += head - ring->m_tail.load(std::memory_order_relaxed);
+            m_heads.push_back(head);
+        }
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        {
+            std::scoped_lock<std::mutex> lock(m_sink_mutex);
+            m_sink(m_buffer);
+        }
+        // Slots are only handed back to the producers once their content went out
+        for (std::size_t i = 0; i < m_draining.size(); i++)
+            m_draining[i]->m_tail.store(m_heads[i], std::memory_order_release);
+        m_draining.clear();
+
+        std::scoped_lock<std::mutex> lock(m_rings_mutex);
+        for (auto it = m_rings.begin(); it != m_rings.end();)
+        {
+            Ring &ring = **it;
+            if (ring.m_retired.load(std::memory_order_acquire)
+                && ring.m_tail.load(std::memory_order_relaxed)
+                       == ring.m_head.load(std::memory_order_acquire))
+            {
+                m_retired_dropped += ring.m_dropped.load(std::memory_order_relaxed);
+                it = m_rings.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return count;
+    }
+
+    void format(const Record &record, std::uint32_t thread_id)
+    {
+        const Format &format = m_formats[record.format];
+
+        const std::time_t seconds = record.timestamp_ns / 1000000000;
+        const int         millis  = static_cast<int>(record.timestamp_ns / 1000000 % 1000);
+        std::tm           local;
+        ::localtime_r(&seconds, &local);
+
+        fmt::dynamic_format_arg_store<fmt::format_context> args;
+        for (std::size_t i = 0; i < record.arg_count; i++)
+        {
+            switch (record.types[i])
+            {
+                case Arg::Type::boolean:
+                    args.push_back(record.args[i].u != 0);
+                    break;
+                case Arg::Type::signed_int:
+                    args.push_back(record.args[i].i);
+                    break;
+                case Arg::Type::unsigned_int:
+                    args.push_back(record.args[i].u);
+                    break;
+                case Arg::Type::floating:
+                    args.push_back(record.args[i].d);
+                    break;
+                case Arg::Type::c_string:
+                    args.push_back(record.args[i].s);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        auto out = std::back_inserter(m_buffer);
+        fmt::format_to(out, "[{:02}:{:02}:{:02}:{:03}][{}][{}][thread_id={}] ", local.tm_hour,
+                       local.tm_min, local.tm_sec, millis, format.component,
+                       level_names[static_cast<int>(format.level)], thread_id);
+        try
+        {
+            fmt::vformat_to(out, format.format, args);
+        }
+        catch (const fmt::format_error &)
+        {
+            // A broken format string must not take the logger down, show it as is
+            fmt::format_to(out, "{}", format.format);
+        }
+        m_buffer.push_back('\n');
+    }
+
+    std::mutex                         m_formats_mutex;
+    std::array<Format, max_formats>    m_formats;
+    std::atomic<std::size_t>           m_format_count{0};
+    std::mutex                         m_sink_mutex;
+    Sink                               m_sink;
+    std::mutex                         m_rings_mutex;
+    std::condition_variable            m_wake;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    // Only touched by drain()
+    std::mutex                         m_drain_mutex;
+    std::vector<std::shared_ptr<Ring>> m_draining;
+    std::vector<std::uint64_t>         m_heads;
+    std::string                        m_buffer;
+    std::uint64_t                      m_retired_dropped{0};
+    bool                               m_stop{false};
+    bool                               m_stopped{false};
+    std::thread                        m_thread;
+};
+
+std::atomic<Level> detail::threshold{Level::info};
+
+Ring *detail::create_thread_ring()
+{
+    // Marks the ring retired when this thread exits
+    struct Owner
+    {
+        Ring *ring;
+        ~Owner()
+        {
+            ring->retire();
+        }
+    };
+    thread_local Owner owner{Backend::instance().create_ring()};
+    return owner.ring;
+}
+
+format_id_t register_format(Level level, const char *component, const char *format)
+{
+    return Backend::instance().register_format(level, component, format);
+}
+
+void set_level(Level level)
+{
+    detail::threshold.store(level, std::memory_order_relaxed);
+}
+
+Level get_level()
+{
+    return detail::threshold.load(std::memory_order_relaxed);
+}
+
+void set_sink(Sink sink)
+{
+    Backend::instance().set_sink(std::move(sink));
+}
+
+void flush()
+{
+    Backend::instance().flush();
+}
+
+std::uint64_t dropped()
+{
+    return Backend::instance().dropped();
+}
+
+}  // namespace AsyncLogger
@@ -0,0 +1,218 @@
+#ifndef __ASYNCLOGGER__
+#define __ASYNCLOGGER__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+/* Project wide asynchronous logger. A log call copies a fixed size binary record (timestamp,
+thread, format id and up to 4 arguments) into a lock-free ring owned by the calling thread, and
+returns. A background thread formats the records with fmt and hands them to the sink in batches.
+Arguments are restricted to what can be copied as is: arithmetic values and C strings with static
+storage (literals, stringify() results...), never pointers to temporaries. When a thread's ring is
+full its records are dropped (and counted) rather than having the caller wait.
+
+    ASYNC_LOG_DEBUG("ThreadSafeQueue", "[put(T &&element)] {} elements", size);
+*/
+namespace AsyncLogger
+{
+
+enum class Level : std::uint8_t
+{
+    debug,
+    info,
+    warn,
+    error,
+    off,
+};
+
+using format_id_t = std::uint16_t;
+// Receives the formatted lines of one batch
+using Sink = std::function<void(std::string_view)>;
+
+inline constexpr std::size_t max_args      = 4;
+inline constexpr std::size_t ring_capacity = 1024;  // Records per thread, a power of two
+
+struct Arg
+{
+    enum class Type : std::uint8_t
+    {
+        none,
+        boolean,
+        signed_int,
+        unsigned_int,
+        floating,
+        c_string,
+    };
+
+    union
+    {
+        std::int64_t  i;
+        std::uint64_t u;
+        double        d;
+        const char   *s;
+    };
+};
+
+struct alignas(64) Record
+{
+    std::int64_t  timestamp_ns;  // Since the system clock epoch
+    format_id_t   format;
+    std::uint8_t  arg_count;
+    Arg::Type     types[max_args];
+    Arg           args[max_args];
+};
+
+// Single producer (the owning thread), single consumer (the background thread)
+class Ring
+{
+   public:
+    explicit Ring(std::uint32_t thread_id) : m_thread_id{thread_id}
+    {
+    }
+
+    bool push(const Record &record)
+    {
+        const std::uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cached_tail == ring_capacity)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cached_tail == ring_capacity)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        m_records[head % ring_capacity] = record;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::uint32_t thread_id() const
+    {
+        return m_thread_id;
+    }
+    // Called when the owning thread exits, the ring goes away once drained
+    void retire()
+    {
+        m_retired.store(true, std::memory_order_release);
+    }
+
+   private:
+    friend class Backend;
+
+    alignas(64) std::atomic<std::uint64_t> m_head{0};
+    std::uint64_t m_cached_tail{0};  // Producer side copy of m_tail
+    alignas(64) std::atomic<std::uint64_t> m_tail{0};
+    alignas(64) std::atomic<std::uint64_t> m_dropped{0};
+    std::atomic<bool>   m_retired{false};  // The owning thread exited
+    const std::uint32_t m_thread_id;
+    Record              m_records[ring_capacity];
+};
+
+namespace detail
+{
+extern std::atomic<Level> threshold;
+Ring                     *create_thread_ring();
+
+template <typename T>
+void store_arg(Record &record, T value)
+{
+    static_assert(std::is_arithmetic_v<T> || std::is_same_v<T, const char *>
+                      || std::is_same_v<T, char *>,
+                  "Only arithmetic values and static C strings can be logged");
+    const std::size_t i = record.arg_count++;
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        record.types[i] = Arg::Type::boolean;
+        record.args[i].u = value;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        record.types[i] = Arg::Type::floating;
+        record.args[i].d = value;
+    }
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    {
+        record.types[i] = Arg::Type::signed_int;
+        record.args[i].i = value;
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        record.types[i] = Arg::Type::unsigned_int;
+        record.args[i].u = value;
+    }
+    else
+    {
+        record.types[i] = Arg::Type::c_string;
+        record.args[i].s = value;
+    }
+}
+
+inline Ring *thread_ring()
+{
+    thread_local Ring *ring = create_thread_ring();
+    return ring;
+}
+}  // namespace detail
+
+inline bool enabled(Level level)
+{
+    return level >= detail::threshold.load(std::memory_order_relaxed);
+}
+
+/* Returns the id log() expects for this format, meant to be called once per call site. Once the
+format table is full, every new call site gets the id of a "format table full" error instead */
+format_id_t register_format(Level level, const char *component, const char *format);
+
+template <typename... Args>
+void log(format_id_t format, Args... args)
+{
+    static_assert(sizeof...(Args) <= max_args, "Too many arguments for a log record");
+    Record record;
+    record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+    record.format    = format;
+    record.arg_count = 0;
+    (detail::store_arg(record, args), ...);
+    detail::thread_ring()->push(record);
+}
+
+void set_level(Level level);
+Level get_level();
+// Replaces the default sink (stdout). Called with nullptr, restores it
+void set_sink(Sink sink);
+// Blocks until everything logged so far reached the sink
+void flush();
+// Records lost so far because a ring was full
+std::uint64_t dropped();
+
+}  // namespace AsyncLogger
+
+#define ASYNC_LOG(level, component, format, ...)                                                 \
+    do                                                                                           \
+    {                                                                                            \
+        if (AsyncLogger::enabled(level))                                                         \
+        {                                                                                        \
+            static const AsyncLogger::format_id_t async_log_format_id =                          \
+                AsyncLogger::register_format(level, component, format);                          \
+            AsyncLogger::log(async_log_format_id __VA_OPT__(, ) __VA_ARGS__);                    \
+        }                                                                                        \
+    } while (0)
+
+#define ASYNC_LOG_DEBUG(component, format, ...)                                                  \
+    ASYNC_LOG(AsyncLogger::Level::debug, component, format __VA_OPT__(, ) __VA_ARGS__)
+#define ASYNC_LOG_INFO(component, format, ...)                                                   \
+    ASYNC_LOG(AsyncLogger::Level::info, component, format __VA_OPT__(, ) __VA_ARGS__)
+#define ASYNC_LOG_WARN(component, format, ...)                                                   \
+    ASYNC_LOG(AsyncLogger::Level::warn, component, format __VA_OPT__(, ) __VA_ARGS__)
+#define ASYNC_LOG_ERROR(component, format, ...)                                                  \
+    ASYNC_LOG(AsyncLogger::Level::error, component, format __VA_OPT__(, ) __VA_ARGS__)
+
+#endif
@@ -1,129 +1,134 @@
 #include "BoostDeadlineTimer.hpp"
 
-#define USE_SPDLOG
-
-#if defined(USE_SPDLOG)
-
-#include "spdlog/spdlog.h"
-#include "spdlog/sinks/stdout_color_sinks.h"
-
-class MyCoolLogger
-{
-   public:
-    MyCoolLogger()
-    {
-        m_logger = spdlog::stdout_color_mt("BoostDeadlineTimer");
-        spdlog::set_pattern("[%H:%M:%S:%e][%n][%^%l%$][thread_id=%t] %v");
-        spdlog::set_level(spdlog::level::info);
-    }
-
-    void Logdebug(const std::string &str)
-    {
-        m_logger->debug(str);
-    }
-    void Loginfo(const std::string &str)
-    {
-        m_logger->info(str);
-    }
-
-   private:
-    std::shared_ptr<spdlog::logger> m_logger;
-};
-
-#else
-
-class MyCoolLogger
-{
-   public:
-    MyCoolLogger()
-    {
-    }
-    void Logdebug(const std::string &str)
-    {
-        std::cout << str << std::endl;
-    }
-    void Loginfo(const std::string &str)
-    {
-        std::cout << str << std::endl;
-    }
-};
-
-#endif
-
-static MyCoolLogger myLocalLogger{};
+#include "AsyncLogger.hpp"
 
 DeadlineTimer::DeadlineTimer(long T, std::function<void(void)> cb, bool cyclic)
-    : m_service{std::make_shared<boost::asio::io_service>()},
+    : m_callback(cb),
+      m_cyclic(cyclic),
+      m_period(T),
+      m_status(Status::stopped),
+      m_service{std::make_shared<boost::asio::io_service>()},
       m_worker{std::unique_ptr<boost::asio::io_service::work>(
           new boost::asio::io_service::work{*m_service})},
-      m_timer(*m_service),
+      m_timer(*m_service)
+{
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[Constructor()]");
+    m_ioc_thread = std::thread(&DeadlineTimer::io_context_runner, this);
+}
+
+DeadlineTimer::DeadlineTimer(const boost::asio::any_io_executor &ex, long T,
+                             std::function<void(void)> cb, bool cyclic)
+    : m_callback(cb),
+      m_cyclic(cyclic),
       m_period(T),
       m_status(Status::stopped),
-      m_callback(cb),
-      m_cyclic(cyclic)
+      m_service{nullptr},
+      m_worker{nullptr},
+      m_timer(ex)
 {
-    myLocalLogger.Logdebug("[Constructor()]");
-    m_ioc_thread = std::thread(&DeadlineTimer::io_context_runner, this);
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[Constructor(executor)]");
 }
 
 DeadlineTimer::~DeadlineTimer()
 {
-    myLocalLogger.Logdebug("[Destructor()]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[Destructor()]");
+    if (!m_service)
+    {
+        /* The executor belongs to someone else, only the pending wait is ours to drop. Its
+        operation_aborted handler runs later, once this is gone: it finds m_lifetime expired */
+        m_status = Status::stopped;
+        m_timer.cancel();
+        std::weak_ptr<void> watch = m_lifetime;
+        m_lifetime.reset();
+        while (!watch.expired())
+            std::this_thread::yield();  // An expiration being handled on another thread
+        return;
+    }
     m_worker.reset();
     m_service->stop();
     if (m_ioc_thread.joinable())
     {
-        myLocalLogger.Logdebug("[void stop()] - thread.join");
+        ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[void stop()] - thread.join");
         m_ioc_thread.join();
     }
 }
 
 void DeadlineTimer::start()
 {
-    myLocalLogger.Logdebug("[void start()]");
-    m_timer.expires_from_now(boost::posix_time::milliseconds(m_period));
-    m_timer.async_wait(
-        boost::bind(&DeadlineTimer::callback, this, boost::asio::placeholders::error));
-    m_status = Status::running;
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[void start()]");
+    arm();
 }
 
 void DeadlineTimer::start(long T)
 {
-    myLocalLogger.Logdebug("[void start(long T)]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[void start(long T)]");
     m_period = T;
-    m_timer.expires_from_now(boost::posix_time::milliseconds(m_period));
-    m_timer.async_wait(
-        boost::bind(&DeadlineTimer::callback, this, boost::asio::placeholders::error));
-    m_status = Status::running;
+    arm();
 }
 
 void DeadlineTimer::start(long T, bool cyclic)
 {
-    myLocalLogger.Logdebug("[void start(long T)]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[void start(long T)]");
     m_period = T;
     m_cyclic = cyclic;
+    arm();
+}
+
+void DeadlineTimer::arm()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    m_due_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()
+                       + m_period * 1000000,
+                   std::memory_order_relaxed);
     m_timer.expires_from_now(boost::posix_time::milliseconds(m_period));
     m_timer.async_wait(
-        boost::bind(&DeadlineTimer::callback, this, boost::asio::placeholders::error));
+        [this, alive = std::weak_ptr<void>(m_lifetime)](const boost::system::error_code &err)
+        {
+            if (const auto guard = alive.lock())
+            {
+                callback(err);
+            }
+        });
     m_status = Status::running;
 }
 
 void DeadlineTimer::stop()
 {
-    myLocalLogger.Logdebug("[void stop()]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[void stop()]");
     m_status = Status::stopped;
     m_timer.cancel();
 }
 
 DeadlineTimer::Status DeadlineTimer::status()
 {
-    myLocalLogger.Logdebug("[DeadlineTimer::Status status()]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[DeadlineTimer::Status status()]");
     return m_status;
 }
 
+DeadlineTimer::Lateness DeadlineTimer::lateness() const
+{
+    Lateness result;
+    result.expirations = m_expirations.load(std::memory_order_acquire);
+    result.total_ns    = m_lateness_total_ns.load(std::memory_order_relaxed);
+    result.max_ns      = m_lateness_max_ns.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::optional<std::chrono::milliseconds> DeadlineTimer::remaining() const
+{
+    if (m_status != Status::running)
+    {
+        return std::nullopt;
+    }
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const auto left = std::chrono::nanoseconds(m_due_ns.load(std::memory_order_relaxed)) - now;
+    return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(left),
+                    std::chrono::milliseconds(0));
+}
+
 void DeadlineTimer::io_context_runner()
 {
-    myLocalLogger.Logdebug("[io_context_runner()]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[io_context_runner()]");
     if (m_service)
     {
         m_service->run();
@@ -132,11 +137,26 @@ void DeadlineTimer::io_context_runner()
 
 void DeadlineTimer::callback(const boost::system::error_code &err)
 {
-    myLocalLogger.Logdebug("[void callback()]");
+    ASYNC_LOG_DEBUG("BoostDeadlineTimer", "[void callback()]");
     if (err)
     {
         return;
     }
+
+    // Only written from here, the loads and stores don't need to be read-modify-write
+    const auto         now     = std::chrono::steady_clock::now().time_since_epoch();
+    const std::int64_t late_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()
+                                 - m_due_ns.load(std::memory_order_relaxed);
+    const std::uint64_t lateness = late_ns > 0 ? static_cast<std::uint64_t>(late_ns) : 0;
+    m_lateness_total_ns.store(m_lateness_total_ns.load(std::memory_order_relaxed) + lateness,
+                              std::memory_order_relaxed);
+    if (lateness > m_lateness_max_ns.load(std::memory_order_relaxed))
+    {
+        m_lateness_max_ns.store(lateness, std::memory_order_relaxed);
+    }
+    m_expirations.store(m_expirations.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+
     m_callback();
     if (m_cyclic && m_status == Status::running)
     {
@@ -1,7 +1,14 @@
 #ifndef __BOOSTDEADLINETIMER__
 #define __BOOSTDEADLINETIMER__
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <thread>
+#include <utility>  // Boost 1.74 asio/awaitable.hpp uses std::exchange without it
 #include <boost/bind/bind.hpp>
 #include <boost/asio.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -15,7 +22,18 @@ class DeadlineTimer
         stopped
     };
 
+    // How late expirations ran their callback compared to when they were due
+    struct Lateness
+    {
+        std::uint64_t expirations{0};
+        std::uint64_t total_ns{0};
+        std::uint64_t max_ns{0};
+    };
+
     DeadlineTimer(long T, std::function<void(void)> cb, bool cyclic);
+    // Runs on an externally owned executor (e.g. a strand): no io_service and no thread of its own
+    DeadlineTimer(const boost::asio::any_io_executor &ex, long T, std::function<void(void)> cb,
+                  bool cyclic);
 
     ~DeadlineTimer();
 
@@ -24,10 +42,15 @@ class DeadlineTimer
     void   start(long T, bool cyclic);
     void   stop();
     Status status();
+    // Lock free, may be read from any thread
+    Lateness lateness() const;
+    // Time left before the next expiration, empty when the timer isn't running
+    std::optional<std::chrono::milliseconds> remaining() const;
 
    private:
     void io_context_runner();
     void callback(const boost::system::error_code &err);
+    void arm();
 
     std::function<void(void)>                      m_callback;
     bool                                           m_cyclic;
@@ -37,6 +60,12 @@ class DeadlineTimer
     std::unique_ptr<boost::asio::io_service::work> m_worker;
     boost::asio::deadline_timer                    m_timer;
     std::thread                                    m_ioc_thread;
+    std::atomic<std::int64_t>                      m_due_ns{0};  // Steady clock
+    std::atomic<std::uint64_t>                     m_expirations{0};
+    std::atomic<std::uint64_t>                     m_lateness_total_ns{0};
+    std::atomic<std::uint64_t>                     m_lateness_max_ns{0};
+    // Held by pending waits, an executor may run them after the timer was destroyed
+    std::shared_ptr<void>                          m_lifetime{std::make_shared<char>()};
 };
 
 #endif
\ No newline at end of file
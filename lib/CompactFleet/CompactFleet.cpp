@@ -0,0 +1,431 @@
+#include "CompactFleet.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+// What a step does besides transitioning
+enum class Effect : std::uint8_t
+{
+    none,
+    unhandled,
+    stop,
+    door_opened,
+    door_closed,
+    heater_on,
+    heater_off,
+};
+
+struct Reaction
+{
+    Effect          effect{Effect::unhandled};
+    tao::StateValue next{tao::StateValue::UNKNOWN};  // UNKNOWN for no transition
+};
+
+constexpr std::size_t event_count = static_cast<std::size_t>(tao::InternalEvent::evt_max);
+
+// GenericToasterState::unhandled_event(), where every state ends up with what it doesn't handle
+constexpr Reaction top_level_reaction(tao::InternalEvent evt)
+{
+    switch (evt)
+    {
+        case tao::InternalEvent::evt_stop:
+            return {Effect::stop};
+        case tao::InternalEvent::evt_door_close:
+            return {Effect::door_closed, tao::StateValue::STATE_HEATING};
+        case tao::InternalEvent::evt_door_open:
+            return {Effect::door_opened, tao::StateValue::STATE_DOOR_OPEN};
+        case tao::InternalEvent::evt_temp_below_target:
+            return {Effect::heater_on};
+        case tao::InternalEvent::evt_temp_above_target:
+            return {Effect::heater_off};
+        default:
+            return {Effect::unhandled};
+    }
+}
+
+// process_internal_event() of each state
+constexpr Reaction reaction_of(tao::StateValue state, tao::InternalEvent evt)
+{
+    switch (state)
+    {
+        case tao::StateValue::STATE_HEATING:
+            if (evt == tao::InternalEvent::evt_do_toasting)
+            {
+                return {Effect::none, tao::StateValue::STATE_TOASTING};
+            }
+            if (evt == tao::InternalEvent::evt_do_baking)
+            {
+                return {Effect::none, tao::StateValue::STATE_BAKING};
+            }
+            break;
+        case tao::StateValue::STATE_TOASTING:
+        case tao::StateValue::STATE_BAKING:
+            if (evt == tao::InternalEvent::evt_alarm_timeout)
+            {
+                return {Effect::none, tao::StateValue::STATE_HEATING};
+            }
+            break;
+        default:
+            break;
+    }
+    return top_level_reaction(evt);
+}
+
+constexpr auto reactions = []()
+{
+    std::array<std::array<Reaction, event_count>, tao::state_count> table{};
+    for (std::size_t state = 0; state < tao::state_count; state++)
+        for (std::size_t evt = 0; evt < event_count; evt++)
+            table[state][evt] = reaction_of(static_cast<tao::StateValue>(state),
+                                            static_cast<tao::InternalEvent>(evt));
+    return table;
+}();
+
+// Bake program of BakingState: heat up to bake_temp, then bake for bake_time_ms
+constexpr float bake_temp    = 50.0f;
+constexpr long  bake_time_ms = 10000;
+// Toaster::arm_time_event(ToastLevel::slightly_overcooked_toast)
+constexpr long toast_time_ms =
+    static_cast<long>(ToasterCore::ToastLevel::slightly_overcooked_toast) * 2000;
+
+}  // namespace
+
+CompactFleet::CompactFleet(std::size_t count, std::size_t workers, Outputs outputs)
+    : m_toasters(count), m_outputs{std::move(outputs)}, m_epoch{clock::now()}
+{
+    for (std::size_t w = 0; w < std::max<std::size_t>(workers, 1); w++)
+        m_workers.push_back(std::make_unique<Worker>());
+    for (Handle toaster = 0; toaster < count; toaster++)
+    {
+        m_toasters[toaster].next_state = static_cast<std::uint8_t>(tao::StateValue::STATE_HEATING);
+        transition(toaster);
+        flush_outputs(toaster);
+    }
+}
+
+CompactFleet::~CompactFleet()
+{
+    stop();
+}
+
+void CompactFleet::start()
+{
+    if (m_started)
+    {
+        return;
+    }
+    m_started = true;
+    for (auto &worker : m_workers)
+        worker->thread = std::thread(&CompactFleet::run, this, std::ref(*worker));
+}
+
+void CompactFleet::stop()
+{
+    if (!m_started)
+    {
+        return;
+    }
+    for (auto &worker : m_workers)
+        worker->queue.put(FleetEvent{stop_marker, tao::InternalEvent::unknown});
+    for (auto &worker : m_workers)
+        worker->thread.join();
+    m_started = false;
+}
+
+void CompactFleet::start(Handle toaster)
+{
+    if (toaster >= m_toasters.size())
+    {
+        ASYNC_LOG_WARN("CompactFleet", "[start()] No toaster {}", toaster);
+        return;
+    }
+    if (!m_started)
+    {
+        m_toasters[toaster].running = 1;
+        return;
+    }
+    m_workers[toaster % m_workers.size()]->queue.put(FleetEvent{toaster, start_marker});
+}
+
+void CompactFleet::put_external_entity_event(Handle toaster, const ExternalEntityEvent &evt)
+{
+    put(toaster, tao::IncomingEventWrapper{evt}.map_incoming_event_to_internal_event());
+}
+
+void CompactFleet::put_temp_sensor_event(Handle toaster, const TempSensorEvent &evt)
+{
+    put(toaster, tao::IncomingEventWrapper{evt}.map_incoming_event_to_internal_event());
+}
+
+void CompactFleet::put(Handle toaster, tao::InternalEvent evt)
+{
+    if (toaster >= m_toasters.size() || evt == tao::InternalEvent::unknown)
+    {
+        ASYNC_LOG_WARN("CompactFleet", "[put()] Dropped event {} for toaster {}",
+                       stringify(evt).c_str(), toaster);
+        return;
+    }
+    m_workers[toaster % m_workers.size()]->queue.put(FleetEvent{toaster, evt});
+}
+
+void CompactFleet::step(Handle toaster, tao::InternalEvent evt)
+{
+    process(toaster, evt);
+}
+
+std::uint64_t CompactFleet::dispatched() const
+{
+    std::uint64_t total = 0;
+    for (const auto &worker : m_workers)
+        total += worker->dispatched.load(std::memory_order_acquire);
+    return total;
+}
+
+std::int64_t CompactFleet::now_ns() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_epoch).count();
+}
+
+void CompactFleet::run(Worker &worker)
+{
+    while (true)
+    {
+        std::shared_ptr<FleetEvent> evt;
+        if (worker.timers.empty())
+        {
+            evt = worker.queue.wait_and_pop();
+        }
+        else
+        {
+            // Up to the next deadline, rounded up so that it is due once the wait is over
+            const std::int64_t wait_ns = std::max<std::int64_t>(
+                worker.timers.top().deadline_ns - now_ns(), 0);
+            evt = worker.queue.wait_and_pop_for(std::chrono::milliseconds((wait_ns + 999999) /
+                                                                          1000000));
+        }
+
+        if (evt)
+        {
+            if (evt->toaster == stop_marker)
+            {
+                return;
+            }
+            if (evt->event == start_marker)
+            {
+                m_toasters[evt->toaster].running = 1;
+            }
+            else if (m_toasters[evt->toaster].running)
+            {
+                process(evt->toaster, evt->event);
+            }
+            worker.dispatched.fetch_add(1, std::memory_order_release);
+        }
+        fire_due_timers(worker);
+    }
+}
+
+void CompactFleet::fire_due_timers(Worker &worker)
+{
+    const std::int64_t now = now_ns();
+    while (!worker.timers.empty() && worker.timers.top().deadline_ns <= now)
+    {
+        const TimerEntry entry = worker.timers.top();
+        worker.timers.pop();
+        CompactToaster &toaster = m_toasters[entry.toaster];
+        // Disarmed or armed again since this entry was pushed
+        if (toaster.timer_generation != entry.generation)
+        {
+            continue;
+        }
+        toaster.timer_deadline_ns = -1;
+        if (toaster.running)
+        {
+            process(entry.toaster, tao::InternalEvent::evt_alarm_timeout);
+        }
+        worker.dispatched.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void CompactFleet::process(Handle handle, tao::InternalEvent evt)
+{
+    CompactToaster &toaster = m_toasters[handle];
+
+    // The bake program consumes the events it waits for before the state does
+    if (toaster.program == 1 && evt == tao::InternalEvent::evt_target_temp_reached)
+    {
+        toaster.program = 2;
+        disarm_timer(toaster);
+        arm_timer(handle, bake_time_ms);
+    }
+    else if (toaster.program == 2 && evt == tao::InternalEvent::evt_alarm_timeout)
+    {
+        toaster.program    = 0;
+        toaster.next_state = static_cast<std::uint8_t>(tao::StateValue::STATE_HEATING);
+    }
+    else
+    {
+        const Reaction &reaction = reactions[toaster.state][static_cast<std::size_t>(evt)];
+        switch (reaction.effect)
+        {
+            case Effect::stop:
+                toaster.running = 0;
+                break;
+            case Effect::door_opened:
+                toaster.door_open = 1;
+                break;
+            case Effect::door_closed:
+                toaster.door_open = 0;
+                break;
+            case Effect::heater_on:
+                heater(toaster, Actuators::IHeater::Status::On);
+                break;
+            case Effect::heater_off:
+                heater(toaster, Actuators::IHeater::Status::Off);
+                break;
+            case Effect::unhandled:
+                toaster.unhandled++;
+                break;
+            default:
+                break;
+        }
+        if (reaction.next != tao::StateValue::UNKNOWN)
+        {
+            toaster.next_state = static_cast<std::uint8_t>(reaction.next);
+        }
+    }
+    transition(handle);
+    flush_outputs(handle);
+    toaster.handled++;
+}
+
+void CompactFleet::transition(Handle handle)
+{
+    CompactToaster &toaster = m_toasters[handle];
+    const auto      next    = static_cast<tao::StateValue>(toaster.next_state);
+    if (next == tao::StateValue::UNKNOWN)
+    {
+        return;
+    }
+    const tao::TransitionPath &path =
+        tao::transition_path(static_cast<tao::StateValue>(toaster.state), next);
+    for (std::size_t i = 0; i < path.exit_count; i++)
+        exit_level(handle, path.exits[i]);
+    if (path.exit_count > 0 && path.lca != tao::StateValue::UNKNOWN)
+    {
+        resume_level(handle, path.lca);
+    }
+    toaster.state      = static_cast<std::uint8_t>(next);
+    toaster.next_state = static_cast<std::uint8_t>(tao::StateValue::UNKNOWN);
+    for (std::size_t i = 0; i < path.entry_count; i++)
+        enter_level(handle, path.entries[i]);
+}
+
+void CompactFleet::enter_level(Handle handle, tao::StateValue level)
+{
+    CompactToaster &toaster = m_toasters[handle];
+    switch (level)
+    {
+        case tao::StateValue::STATE_HEATING:
+            set_target_temperature(toaster, tao::HeatingSuperState::target_temperature());
+            heater(toaster, Actuators::IHeater::Status::On);
+            break;
+        case tao::StateValue::STATE_TOASTING:
+            arm_timer(handle, toast_time_ms);
+            break;
+        case tao::StateValue::STATE_BAKING:
+            toaster.program = 1;
+            set_target_temperature(toaster, bake_temp);
+            heater(toaster, Actuators::IHeater::Status::On);
+            break;
+        default:
+            break;
+    }
+}
+
+void CompactFleet::exit_level(Handle handle, tao::StateValue level)
+{
+    CompactToaster &toaster = m_toasters[handle];
+    switch (level)
+    {
+        case tao::StateValue::STATE_HEATING:
+            set_target_temperature(toaster, DEMO_AMBIENT_TEMP);
+            heater(toaster, Actuators::IHeater::Status::Off);
+            break;
+        case tao::StateValue::STATE_TOASTING:
+            disarm_timer(toaster);
+            break;
+        case tao::StateValue::STATE_BAKING:
+            toaster.program = 0;
+            disarm_timer(toaster);
+            break;
+        default:
+            break;
+    }
+}
+
+// tao::HeatingSuperState::resume_level()
+void CompactFleet::resume_level(Handle handle, tao::StateValue level)
+{
+    CompactToaster &toaster = m_toasters[handle];
+    if (level != tao::StateValue::STATE_HEATING)
+    {
+        return;
+    }
+    if (toaster.target_temp != tao::HeatingSuperState::target_temperature())
+    {
+        set_target_temperature(toaster, tao::HeatingSuperState::target_temperature());
+    }
+    heater(toaster, Actuators::IHeater::Status::On);
+}
+
+void CompactFleet::flush_outputs(Handle handle)
+{
+    CompactToaster &toaster = m_toasters[handle];
+    if (toaster.heater_requested != 0 && toaster.heater_requested != toaster.heater_written)
+    {
+        toaster.heater_written = toaster.heater_requested;
+        if (m_outputs.heater)
+        {
+            m_outputs.heater(handle,
+                             static_cast<Actuators::IHeater::Status>(toaster.heater_written - 1));
+        }
+    }
+    if (toaster.target_pending)
+    {
+        toaster.target_pending = 0;
+        if (m_outputs.target_temperature)
+        {
+            m_outputs.target_temperature(handle, toaster.target_temp);
+        }
+    }
+}
+
+void CompactFleet::set_target_temperature(CompactToaster &toaster, float temp)
+{
+    toaster.target_temp    = temp;
+    toaster.target_pending = 1;
+}
+
+void CompactFleet::heater(CompactToaster &toaster, Actuators::IHeater::Status status)
+{
+    toaster.heater_requested = static_cast<std::uint8_t>(1 + static_cast<int>(status));
+}
+
+void CompactFleet::arm_timer(Handle handle, long period_ms)
+{
+    CompactToaster &toaster = m_toasters[handle];
+    toaster.timer_generation++;
+    toaster.timer_deadline_ns = now_ns() + static_cast<std::int64_t>(period_ms) * 1000000;
+    m_workers[handle % m_workers.size()]->timers.push(
+        TimerEntry{toaster.timer_deadline_ns, handle, toaster.timer_generation});
+}
+
+void CompactFleet::disarm_timer(CompactToaster &toaster)
+{
+    // The heap entry stays, it is skipped once due
+    toaster.timer_generation++;
+    toaster.timer_deadline_ns = -1;
+}
@@ -0,0 +1,148 @@
+#ifndef __COMPACTFLEET__
+#define __COMPACTFLEET__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "ToasterActiveObject.hpp"
+
+/* Per toaster state of a CompactFleet: plain data in half a cache line, fields touched by every
+step first. Everything a Toaster owns for itself (thread, queue, timer, state object, metrics,
+trace) is a service of the fleet here, the toaster only keeps its handle into them */
+struct alignas(32) CompactToaster
+{
+    std::uint8_t  state{0};             // tao::StateValue
+    std::uint8_t  door_open{0};
+    std::uint8_t  running{1};           // Cleared by evt_stop, set by start(Handle)
+    std::uint8_t  program{0};           // Bake program: 0 none, 1 heating up, 2 baking
+    std::uint8_t  heater_requested{0};  // 0 nothing requested, else 1 + Actuators::IHeater::Status
+    std::uint8_t  heater_written{0};    // Same, what the heater was last told
+    std::uint8_t  target_pending{0};    // target_temp still has to reach the sensor
+    std::uint8_t  next_state{0};
+    float         target_temp{0.0f};
+    std::uint32_t timer_generation{0};  // Bumped by every arm / disarm, stale expirations skipped
+    std::int64_t  timer_deadline_ns{-1};  // Since the fleet was created, -1 when not armed
+    std::uint32_t handled{0};
+    std::uint32_t unhandled{0};
+};
+
+/* Many toasters, each a CompactToaster, run by a fixed number of worker threads. Toaster h
+belongs to worker h % workers: its events go through that worker's queue and its alarm to that
+worker's timer heap, so the events of one toaster are handled in order and never concurrently.
+
+Behaviour is the one of Toaster, driven by tables instead of state objects: what each state does
+with each event is resolved once, at compile time, through the hierarchy, and transitions run the
+exit / entry actions of tao::transition_path(). The bake program is a two phase field instead of a
+coroutine. Heater commands and target temperatures are applied once per step, through outputs
+shared by the whole fleet.
+
+A toaster that handled evt_stop drops its later events and alarms, the others go on. start(Handle)
+takes it back where it stopped, from the events put after that call. */
+class CompactFleet
+{
+   public:
+    using Handle = std::uint32_t;
+    using clock  = std::chrono::steady_clock;
+
+    // Both optional, called from the worker of the toaster, only when the value changes
+    struct Outputs
+    {
+        std::function<void(Handle, Actuators::IHeater::Status)> heater;
+        std::function<void(Handle, float)>                      target_temperature;
+    };
+
+    CompactFleet(std::size_t count, std::size_t workers = 1, Outputs outputs = {});
+    ~CompactFleet();
+
+    CompactFleet(const CompactFleet &)            = delete;
+    CompactFleet &operator=(const CompactFleet &) = delete;
+
+    void start();
+    void stop();
+
+    // From any thread, queued behind the events already put for toaster (applied at once before
+    // start()). Counted by dispatched() once handled
+    void start(Handle toaster);
+    void put_external_entity_event(Handle toaster, const ExternalEntityEvent &evt);
+    void put_temp_sensor_event(Handle toaster, const TempSensorEvent &evt);
+
+    // One step on the calling thread, for a fleet that isn't started
+    void step(Handle toaster, tao::InternalEvent evt);
+
+    std::size_t size() const
+    {
+        return m_toasters.size();
+    }
+    // Only meant to be read once dispatched() says the events of interest were handled
+    const CompactToaster &operator[](Handle toaster) const
+    {
+        return m_toasters[toaster];
+    }
+    tao::StateValue state(Handle toaster) const
+    {
+        return static_cast<tao::StateValue>(m_toasters[toaster].state);
+    }
+    // Events handled by the workers so far, alarms included
+    std::uint64_t dispatched() const;
+
+   private:
+    struct FleetEvent
+    {
+        Handle             toaster;
+        tao::InternalEvent event;
+    };
+    struct TimerEntry
+    {
+        std::int64_t  deadline_ns;
+        Handle        toaster;
+        std::uint32_t generation;
+
+        bool operator>(const TimerEntry &other) const
+        {
+            return deadline_ns > other.deadline_ns;
+        }
+    };
+    struct Worker
+    {
+        SimplestThreadSafeQueue<FleetEvent> queue;
+        // Only touched by the worker thread (or by step() before start())
+        std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timers;
+        std::atomic<std::uint64_t> dispatched{0};
+        std::thread                thread;
+    };
+
+    static constexpr Handle stop_marker = ~Handle{0};
+    // FleetEvent::event of the marker start(Handle) queues, put() never queues it for an event
+    static constexpr tao::InternalEvent start_marker = tao::InternalEvent::unknown;
+
+    void         put(Handle toaster, tao::InternalEvent evt);
+    void         run(Worker &worker);
+    void         fire_due_timers(Worker &worker);
+    std::int64_t now_ns() const;
+
+    void process(Handle toaster, tao::InternalEvent evt);
+    void transition(Handle toaster);
+    void enter_level(Handle toaster, tao::StateValue level);
+    void exit_level(Handle toaster, tao::StateValue level);
+    void resume_level(Handle toaster, tao::StateValue level);
+    void flush_outputs(Handle toaster);
+
+    void set_target_temperature(CompactToaster &toaster, float temp);
+    void heater(CompactToaster &toaster, Actuators::IHeater::Status status);
+    void arm_timer(Handle toaster, long period_ms);
+    void disarm_timer(CompactToaster &toaster);
+
+    std::vector<CompactToaster>          m_toasters;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    Outputs                              m_outputs;
+    clock::time_point                    m_epoch;
+    bool                                 m_started{false};
+};
+
+#endif
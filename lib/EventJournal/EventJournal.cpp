@@ -0,0 +1,278 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+
+#include "EventJournal.hpp"
+#include "MappedFile.hpp"
+
+/* The segment structs outlive their mapping: a late append() may still look at the slot counter
+of a segment that was already retired, it then finds it full and moves on to the current one */
+struct EventJournal::Segment
+{
+    std::optional<MappedFile>  file;
+    JournalRecord             *records{nullptr};
+    std::size_t                capacity{0};
+    std::atomic<std::size_t>   next{0};     // Slots claimed, can go past capacity
+    std::atomic<std::size_t>   written{0};  // Slots completely written
+};
+
+namespace
+{
+std::string segment_path(const std::string &directory, const std::string &name, std::uint64_t index)
+{
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu.journal",
+                  static_cast<unsigned long long>(index));
+    return (std::filesystem::path(directory) / (name + suffix)).string();
+}
+
+// Index of every segment of name found in directory, in order
+std::vector<std::uint64_t> segment_indexes(const std::string &directory, const std::string &name)
+{
+    std::vector<std::uint64_t> indexes;
+    std::error_code            ec;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+    {
+        const std::string file = entry.path().filename().string();
+        unsigned long long index;
+        char               extension[16];
+        if (file.compare(0, name.size() + 1, name + ".") == 0
+            && std::sscanf(file.c_str() + name.size() + 1, "%llu.%15s", &index, extension) == 2
+            && std::strcmp(extension, "journal") == 0)
+        {
+            indexes.push_back(index);
+        }
+    }
+    std::sort(indexes.begin(), indexes.end());
+    return indexes;
+}
+
+std::int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+}  // namespace
+
+/* *************************************************************************************************
+Implementations of EventJournal
+************************************************************************************************* */
+
+EventJournal::EventJournal(const std::string &directory, const std::string &name)
+    : EventJournal(directory, name, Options{})
+{
+}
+
+EventJournal::EventJournal(const std::string &directory, const std::string &name, Options options)
+    : m_directory{directory}, m_name{name}, m_options{options}
+{
+    std::filesystem::create_directories(directory);
+    const auto existing = segment_indexes(directory, name);
+    m_next_index        = existing.empty() ? 0 : existing.back() + 1;
+
+    m_segments.push_back(open_segment());
+    m_current.store(m_segments.back().get(), std::memory_order_release);
+    m_flusher = std::thread(&EventJournal::flusher, this);
+}
+
+EventJournal::~EventJournal()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_flusher.join();
+
+    // The spare segment was never written to
+    if (m_spare)
+    {
+        const std::string path = m_spare->file->path();
+        m_spare.reset();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+}
+
+void EventJournal::append(std::uint32_t source, std::uint16_t event, std::uint16_t flags)
+{
+    const std::int64_t timestamp = now_ns();
+    while (true)
+    {
+        Segment          *segment = m_current.load(std::memory_order_acquire);
+        const std::size_t slot    = segment->next.fetch_add(1, std::memory_order_relaxed);
+        if (slot < segment->capacity)
+        {
+            JournalRecord &record = segment->records[slot];
+            record.source         = source;
+            record.event          = event;
+            record.flags          = flags;
+            // Written last, a slot with a timestamp holds a complete record
+            std::atomic_ref<std::int64_t>(record.timestamp_ns)
+                .store(timestamp, std::memory_order_release);
+            segment->written.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        rotate(segment);
+    }
+}
+
+void EventJournal::commit()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // A round already under way may have synced before the caller's last records were written
+    const std::uint64_t target = m_commits + (m_flushing ? 2 : 1);
+    m_commit_requested         = true;
+    m_cv.notify_all();
+    m_cv.wait(lock, [&]() { return m_commits >= target || m_stopping; });
+}
+
+std::uint64_t EventJournal::commits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_commits;
+}
+
+std::uint64_t EventJournal::segments() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_segments.size();
+}
+
+std::unique_ptr<EventJournal::Segment> EventJournal::open_segment()
+{
+    const std::uint64_t index = m_next_index++;
+    const std::size_t   size =
+        sizeof(JournalHeader) + m_options.segment_records * sizeof(JournalRecord);
+    auto segment = std::make_unique<Segment>();
+    segment->file.emplace(segment_path(m_directory, m_name, index), MappedFile::Mode::read_write,
+                          size);
+
+    JournalHeader header{};
+    std::memcpy(header.magic, journal_magic, sizeof(journal_magic));
+    header.version = journal_version;
+    header.index   = index;
+    std::memcpy(segment->file->data(), &header, sizeof(header));
+
+    // Faults the pages in now rather than on the first append() touching each of them
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const auto       *bytes = reinterpret_cast<volatile const std::byte *>(segment->file->data());
+    for (std::size_t offset = page; offset < size; offset += page)
+        static_cast<void>(bytes[offset]);
+
+    segment->records  = reinterpret_cast<JournalRecord *>(segment->file->data() + sizeof(header));
+    segment->capacity = m_options.segment_records;
+    return segment;
+}
+
+void EventJournal::rotate(Segment *full)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_current.load(std::memory_order_relaxed) != full)
+    {
+        // Another append() got there first
+        return;
+    }
+    std::unique_ptr<Segment> next = m_spare ? std::move(m_spare) : open_segment();
+    m_current.store(next.get(), std::memory_order_release);
+    m_segments.push_back(std::move(next));
+    // Time to get the next spare ready
+    m_cv.notify_all();
+}
+
+void EventJournal::flusher()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping)
+    {
+        m_cv.wait_for(lock, m_options.commit_interval,
+                      [this]() { return m_stopping || m_commit_requested || !m_spare; });
+        if (!m_spare)
+        {
+            m_spare = open_segment();
+        }
+        m_commit_requested = false;
+        m_flushing         = true;
+        lock.unlock();
+        flush_round();
+        lock.lock();
+        m_flushing = false;
+        m_commits++;
+        m_cv.notify_all();
+    }
+    lock.unlock();
+    flush_round();
+}
+
+void EventJournal::flush_round()
+{
+    std::vector<Segment *> live;
+    Segment               *current;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        current = m_current.load(std::memory_order_relaxed);
+        for (const auto &segment : m_segments)
+            if (segment->file)
+            {
+                live.push_back(segment.get());
+            }
+    }
+
+    for (Segment *segment : live)
+    {
+        // Only the dirty pages of the range are actually written
+        const std::size_t used =
+            std::min(segment->next.load(std::memory_order_relaxed), segment->capacity);
+        segment->file->sync(0, sizeof(JournalHeader) + used * sizeof(JournalRecord));
+
+        // Nobody writes into a full segment anymore once all of its slots are written
+        if (segment != current
+            && segment->written.load(std::memory_order_acquire) == segment->capacity)
+        {
+            segment->file.reset();
+            segment->records = nullptr;
+        }
+    }
+}
+
+std::vector<JournalRecord> EventJournal::read(const std::string &directory,
+                                              const std::string &name)
+{
+    std::vector<JournalRecord> records;
+    for (std::uint64_t index : segment_indexes(directory, name))
+    {
+        const std::string path = segment_path(directory, name, index);
+        MappedFile        file{path, MappedFile::Mode::read_only};
+        JournalHeader     header;
+        if (file.size() < sizeof(header))
+        {
+            throw std::runtime_error(path + ": too short to be a journal segment");
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, journal_magic, sizeof(journal_magic)) != 0)
+        {
+            throw std::runtime_error(path + ": not a journal segment");
+        }
+        if (header.version != journal_version)
+        {
+            throw std::runtime_error(path + ": unsupported journal version");
+        }
+
+        const auto *slots = reinterpret_cast<const JournalRecord *>(file.data() + sizeof(header));
+        const std::size_t count = (file.size() - sizeof(header)) / sizeof(JournalRecord);
+        file.advise_sequential();
+        for (std::size_t i = 0; i < count; i++)
+            if (slots[i].timestamp_ns != 0)
+            {
+                records.push_back(slots[i]);
+            }
+    }
+    return records;
+}
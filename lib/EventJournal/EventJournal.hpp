@@ -0,0 +1,81 @@
+#ifndef __EVENTJOURNAL__
+#define __EVENTJOURNAL__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JournalFormat.hpp"
+
+/* Append-only binary journal, split in fixed size segments named <name>.<index>.journal in its
+directory. Each segment is a file mapped in memory: append() claims a slot with an atomic increment
+and writes the record straight into the mapping, without any system call or lock. Only moving on to
+the next segment takes a lock, and a spare segment is kept ready for it.
+
+Durability is a group commit: a flusher thread msyncs what was appended every commit_interval, or as
+soon as someone waits in commit(), so one msync covers all the records appended in between. A new
+journal never writes into the segments of a previous one, it starts after the last of them. */
+class EventJournal
+{
+   public:
+    struct Options
+    {
+        std::size_t               segment_records{std::size_t{1} << 18};  // 4 MiB segments
+        std::chrono::milliseconds commit_interval{5};
+    };
+
+    /* Throws std::system_error when the directory or the first segment can't be created */
+    EventJournal(const std::string &directory, const std::string &name);
+    EventJournal(const std::string &directory, const std::string &name, Options options);
+    // Commits everything appended so far
+    ~EventJournal();
+
+    EventJournal(const EventJournal &)            = delete;
+    EventJournal &operator=(const EventJournal &) = delete;
+
+    // Safe from any thread. Throws std::system_error when a new segment can't be created
+    void append(std::uint32_t source, std::uint16_t event, std::uint16_t flags = 0);
+    // Returns once every record appended before the call is on disk
+    void commit();
+
+    std::uint64_t commits() const;
+    std::uint64_t segments() const;
+
+    /* Records of every segment of a journal, in append order. Throws std::runtime_error when a
+    segment is not a journal segment */
+    static std::vector<JournalRecord> read(const std::string &directory, const std::string &name);
+
+   private:
+    struct Segment;
+
+    std::unique_ptr<Segment> open_segment();
+    void                     rotate(Segment *full);
+    void                     flusher();
+    void                     flush_round();
+
+    std::string           m_directory;
+    std::string           m_name;
+    Options               m_options;
+    std::atomic<Segment *> m_current{nullptr};
+
+    // Guards everything below, never taken by append() but to rotate
+    mutable std::mutex                    m_mutex;
+    std::condition_variable               m_cv;
+    std::vector<std::unique_ptr<Segment>> m_segments;  // Oldest first, m_current is the last one
+    std::unique_ptr<Segment>              m_spare;
+    std::uint64_t                         m_next_index{0};
+    std::uint64_t                         m_commits{0};
+    bool                                  m_commit_requested{false};
+    bool                                  m_flushing{false};
+    bool                                  m_stopping{false};
+    std::thread                           m_flusher;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __JOURNALFORMAT__
+#define __JOURNALFORMAT__
+
+#include <cstdint>
+
+/* On disk layout of a journal segment: one JournalHeader followed by a fixed number of
+JournalRecords, in the byte order of the host that wrote it. Records are in append order. A slot
+with a zero timestamp was never (completely) written and is skipped when reading. */
+inline constexpr char          journal_magic[4] = {'T', 'J', 'R', 'N'};
+inline constexpr std::uint32_t journal_version  = 1;
+
+struct JournalHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint64_t index;  // Position of the segment in the journal
+};
+
+struct JournalRecord
+{
+    std::int64_t  timestamp_ns;  // System clock, written last
+    std::uint32_t source;        // Whoever appended it, a toaster id for instance
+    std::uint16_t event;         // tao::IncomingEventWrapper::encode()
+    std::uint16_t flags;  // prioritized, then waiting() in the bits above it
+
+    static constexpr std::uint16_t prioritized = 1;  // Put at the front of the queue
+    static constexpr std::uint16_t max_waiting = 0x7fff;
+
+    // Events already waiting in the queue of the source when it was put, saturated
+    std::uint16_t waiting() const
+    {
+        return static_cast<std::uint16_t>(flags >> 1);
+    }
+    static constexpr std::uint16_t make_flags(std::uint16_t prioritized_flag, std::uint64_t waiting)
+    {
+        const std::uint64_t saturated = waiting < max_waiting ? waiting : max_waiting;
+        return static_cast<std::uint16_t>((saturated << 1) | (prioritized_flag & prioritized));
+    }
+};
+
+static_assert(sizeof(JournalHeader) == 16, "JournalHeader layout is part of the file format");
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord layout is part of the file format");
+
+#endif
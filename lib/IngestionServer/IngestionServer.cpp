@@ -0,0 +1,246 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+#include "IngestionServer.hpp"
+
+namespace
+{
+
+constexpr int backlog    = 128;
+constexpr int max_events = 64;
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+}  // namespace
+
+IngestionServer::IngestionServer(std::string path) : m_path{std::move(path)}
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (m_path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                                "IngestionServer: " + m_path);
+    }
+    std::strcpy(addr.sun_path, m_path.c_str());
+
+    m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listen_fd < 0)
+    {
+        throw_errno("IngestionServer: socket");
+    }
+    struct stat existing;
+    if (::lstat(addr.sun_path, &existing) == 0)
+    {
+        if (!S_ISSOCK(existing.st_mode))
+        {
+            ::close(m_listen_fd);
+            throw std::system_error(EEXIST, std::generic_category(),
+                                    "IngestionServer: not a socket: " + m_path);
+        }
+        ::unlink(addr.sun_path);  // Left behind by a previous run
+    }
+    m_epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wake_fd  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event listen_event{};
+    listen_event.events  = EPOLLIN;
+    listen_event.data.fd = m_listen_fd;
+    epoll_event wake_event{};
+    wake_event.events  = EPOLLIN;
+    wake_event.data.fd = m_wake_fd;
+    if (::bind(m_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(m_listen_fd, backlog) != 0 || m_epoll_fd < 0 || m_wake_fd < 0
+        || ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_listen_fd, &listen_event) != 0
+        || ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &wake_event) != 0)
+    {
+        const int error = errno;
+        ::close(m_listen_fd);
+        ::close(m_epoll_fd);
+        ::close(m_wake_fd);
+        throw std::system_error(error, std::generic_category(), "IngestionServer: bind/listen");
+    }
+}
+
+IngestionServer::~IngestionServer()
+{
+    stop();
+    for (const auto &[fd, connection] : m_connections)
+        ::close(fd);
+    ::close(m_listen_fd);
+    ::close(m_epoll_fd);
+    ::close(m_wake_fd);
+    ::unlink(m_path.c_str());
+}
+
+std::uint32_t IngestionServer::add_toaster(std::shared_ptr<Toaster> toaster)
+{
+    m_toasters.push_back(std::move(toaster));
+    return static_cast<std::uint32_t>(m_toasters.size() - 1);
+}
+
+void IngestionServer::start()
+{
+    if (m_running.exchange(true))
+    {
+        return;
+    }
+    m_batches.resize(m_toasters.size());
+    m_pending.reserve(m_toasters.size());
+    m_thread = std::thread(&IngestionServer::serve, this);
+}
+
+void IngestionServer::stop()
+{
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+    const std::uint64_t wake = 1;
+    (void)::write(m_wake_fd, &wake, sizeof(wake));
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+IngestionServer::Stats IngestionServer::stats() const
+{
+    return Stats{m_accepted.load(std::memory_order_relaxed),
+                 m_frames.load(std::memory_order_relaxed),
+                 m_rejected.load(std::memory_order_relaxed),
+                 m_batches_put.load(std::memory_order_relaxed)};
+}
+
+void IngestionServer::serve()
+{
+    epoll_event events[max_events];
+    while (m_running)
+    {
+        const int count = ::epoll_wait(m_epoll_fd, events, max_events, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ASYNC_LOG_ERROR("IngestionServer", "epoll_wait failed: {}", errno);
+            return;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            const int fd = events[i].data.fd;
+            if (fd == m_wake_fd)
+            {
+                return;
+            }
+            if (fd == m_listen_fd)
+            {
+                accept_clients();
+                continue;
+            }
+            auto connection = m_connections.find(fd);
+            if (connection != m_connections.end() && !receive(fd, *connection->second))
+            {
+                close_connection(fd);
+            }
+        }
+        // Everything read in this round reaches the toasters now
+        flush_batches();
+    }
+}
+
+void IngestionServer::accept_clients()
+{
+    while (true)
+    {
+        const int client = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            return;
+        }
+        epoll_event event{};
+        event.events  = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = client;
+        if (::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, client, &event) != 0)
+        {
+            ::close(client);
+            continue;
+        }
+        m_connections.emplace(client, std::make_unique<Connection>());
+        m_accepted.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool IngestionServer::receive(int fd, Connection &connection)
+{
+    // One read per round, so a busy client can't starve the others
+    const ssize_t received = ::recv(fd, connection.buffer.data() + connection.size,
+                                    connection.buffer.size() - connection.size, 0);
+    if (received < 0)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    if (received == 0)
+    {
+        return false;
+    }
+
+    const char *frame = connection.buffer.data();
+    const char *end   = frame + connection.size + static_cast<std::size_t>(received);
+    std::size_t frames = 0;
+    for (; end - frame >= static_cast<std::ptrdiff_t>(frame_size); frame += frame_size, frames++)
+        route(frame);
+    m_frames.fetch_add(frames, std::memory_order_relaxed);
+
+    // The start of a frame still to come
+    connection.size = static_cast<std::size_t>(end - frame);
+    std::memmove(connection.buffer.data(), frame, connection.size);
+    return true;
+}
+
+void IngestionServer::route(const char *frame)
+{
+    std::uint32_t toaster;
+    std::uint16_t code;
+    std::memcpy(&toaster, frame, sizeof(toaster));
+    std::memcpy(&code, frame + sizeof(toaster), sizeof(code));
+
+    tao::IncomingEventWrapper event = tao::IncomingEventWrapper::decode(code);
+    if (toaster >= m_toasters.size() || event.is_internal()
+        || event.map_incoming_event_to_internal_event() == tao::InternalEvent::unknown)
+    {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (m_batches[toaster].empty())
+    {
+        m_pending.push_back(toaster);
+    }
+    m_batches[toaster].push_back(std::move(event));
+}
+
+void IngestionServer::flush_batches()
+{
+    for (std::uint32_t toaster : m_pending)
+        m_toasters[toaster]->put_batch(m_batches[toaster]);
+    m_batches_put.fetch_add(m_pending.size(), std::memory_order_relaxed);
+    m_pending.clear();
+}
+
+void IngestionServer::close_connection(int fd)
+{
+    ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_connections.erase(fd);
+}
@@ -0,0 +1,97 @@
+#ifndef __INGESTIONSERVER__
+#define __INGESTIONSERVER__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ToasterActiveObject.hpp"
+
+/* Takes commands for a fleet of toasters from any number of clients, over a Unix domain socket,
+on a single thread of its own multiplexing them all with epoll. Clients write a stream of fixed
+size frames, without any header or handshake:
+
+    toaster id (4 bytes) | event (2 bytes, IncomingEventWrapper::encode() form)
+
+both in host byte order, the socket being local. Frames are decoded straight out of each
+connection's receive buffer. The commands of everything read in one epoll round are grouped per
+toaster, then queued with one put_batch() per toaster. Frames for an unknown toaster, of an event
+internal to the toaster or of no known event are counted as rejected and dropped.
+
+The socket file is created at path and removed by the destructor. One left there by a server that
+didn't shut down is replaced, but any other file at path is left alone and the constructor throws
+std::system_error (EEXIST), as it does on any other failure to bind or listen. */
+class IngestionServer
+{
+   public:
+    static constexpr std::size_t frame_size = 6;
+
+    static void write_frame(char *out, std::uint32_t toaster, std::uint16_t event)
+    {
+        std::memcpy(out, &toaster, sizeof(toaster));
+        std::memcpy(out + sizeof(toaster), &event, sizeof(event));
+    }
+
+    struct Stats
+    {
+        std::uint64_t connections;  // Accepted so far
+        std::uint64_t frames;       // Received, rejected ones included
+        std::uint64_t rejected;
+        std::uint64_t batches;  // put_batch() calls
+    };
+
+    explicit IngestionServer(std::string path);
+    ~IngestionServer();
+
+    IngestionServer(const IngestionServer &)            = delete;
+    IngestionServer &operator=(const IngestionServer &) = delete;
+
+    // Returns the id clients address the toaster with. Only before start()
+    std::uint32_t add_toaster(std::shared_ptr<Toaster> toaster);
+
+    void start();
+    void stop();
+
+    Stats stats() const;
+
+   private:
+    struct Connection
+    {
+        std::array<char, 64 * 1024> buffer;
+        std::size_t                 size{0};  // A partial frame at most, between two reads
+    };
+
+    void serve();
+    void accept_clients();
+    // False once the client is gone
+    bool receive(int fd, Connection &connection);
+    void route(const char *frame);
+    void flush_batches();
+    void close_connection(int fd);
+
+    std::string       m_path;
+    int               m_listen_fd{-1};
+    int               m_epoll_fd{-1};
+    int               m_wake_fd{-1};  // eventfd, wakes serve() up on stop()
+    std::atomic<bool> m_running{false};
+    std::thread       m_thread;
+
+    std::vector<std::shared_ptr<Toaster>> m_toasters;
+    // Owned by the serving thread
+    std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+    std::vector<std::vector<tao::IncomingEventWrapper>>  m_batches;  // One per toaster
+    std::vector<std::uint32_t>                           m_pending;  // Toasters with a batch
+
+    std::atomic<std::uint64_t> m_accepted{0};
+    std::atomic<std::uint64_t> m_frames{0};
+    std::atomic<std::uint64_t> m_rejected{0};
+    std::atomic<std::uint64_t> m_batches_put{0};
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include "MappedFile.hpp"
+
+namespace
+{
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+}  // namespace
+
+MappedFile::MappedFile(const std::string &path, Mode mode, std::size_t size) : m_path{path}
+{
+    const bool writable = mode == Mode::read_write;
+    m_fd                = ::open(path.c_str(), writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (m_fd < 0)
+    {
+        throw_errno("open " + path);
+    }
+
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0)
+    {
+        release();
+        throw_errno("fstat " + path);
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (writable && m_size < size)
+    {
+        if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+        {
+            release();
+            throw_errno("ftruncate " + path);
+        }
+        m_size = size;
+    }
+    if (m_size == 0)
+    {
+        // Nothing to map, an empty file is a valid (empty) mapping
+        return;
+    }
+
+    void *addr = ::mmap(nullptr, m_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                        MAP_SHARED, m_fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        release();
+        throw_errno("mmap " + path);
+    }
+    m_data = static_cast<std::byte *>(addr);
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_path{std::move(other.m_path)},
+      m_fd{std::exchange(other.m_fd, -1)},
+      m_data{std::exchange(other.m_data, nullptr)},
+      m_size{std::exchange(other.m_size, 0)}
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_path = std::move(other.m_path);
+        m_fd   = std::exchange(other.m_fd, -1);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+void MappedFile::advise_sequential()
+{
+    if (m_data != nullptr)
+    {
+        ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+    }
+}
+
+void MappedFile::sync(std::size_t offset, std::size_t length, bool async)
+{
+    if (m_data == nullptr || length == 0)
+    {
+        return;
+    }
+    // msync wants a page aligned address
+    const std::size_t page  = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t start = offset / page * page;
+    if (::msync(m_data + start, offset + length - start, async ? MS_ASYNC : MS_SYNC) != 0)
+    {
+        throw_errno("msync " + m_path);
+    }
+}
+
+void MappedFile::release()
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __MAPPEDFILE__
+#define __MAPPEDFILE__
+
+#include <cstddef>
+#include <string>
+
+/* RAII wrapper around a file mapped in memory with mmap. Failures to open, size or map the file
+are reported by throwing std::system_error. */
+class MappedFile
+{
+   public:
+    enum class Mode
+    {
+        read_only,
+        read_write,  // Created when missing, grown to size when smaller
+    };
+
+    MappedFile(const std::string &path, Mode mode, std::size_t size = 0);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::byte *data()
+    {
+        return m_data;
+    }
+    const std::byte *data() const
+    {
+        return m_data;
+    }
+    std::size_t size() const
+    {
+        return m_size;
+    }
+    const std::string &path() const
+    {
+        return m_path;
+    }
+
+    // Hints the kernel the mapping will be walked front to back
+    void advise_sequential();
+    // Writes [offset, offset + length) back to the file; async only schedules the write
+    void sync(std::size_t offset, std::size_t length, bool async = false);
+
+   private:
+    void release();
+
+    std::string m_path;
+    int         m_fd{-1};
+    std::byte  *m_data{nullptr};
+    std::size_t m_size{0};
+};
+
+#endif
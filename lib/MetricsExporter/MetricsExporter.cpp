@@ -0,0 +1,399 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include "MetricsExporter.hpp"
+
+namespace
+{
+
+constexpr int    backlog            = 16;
+constexpr int    request_timeout_ms = 1000;
+constexpr size_t max_request_size   = 4096;
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void write_all(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return;  // The scraper went away, nothing to report it to
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+// Label values escape backslashes, double quotes and line feeds
+std::string escape(const std::string &value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (c == '\n')
+        {
+            result += "\\n";
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+void family(std::ostream &os, const char *name, const char *type, const char *help)
+{
+    os << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+}
+
+double seconds(std::uint64_t ns)
+{
+    return static_cast<double>(ns) * 1e-9;
+}
+
+struct Sample
+{
+    std::string                             name;
+    std::size_t                             queue_depth;
+    tao::MetricsSnapshot                    metrics;
+    DeadlineTimer::Lateness                 lateness;
+    std::optional<std::chrono::nanoseconds> cpu_time;
+};
+
+}  // namespace
+
+MetricsExporter::MetricsExporter(Endpoint endpoint) : m_endpoint{std::move(endpoint)}
+{
+    const bool unix_socket = !m_endpoint.path.empty();
+    m_listen_fd = ::socket(unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listen_fd < 0)
+    {
+        throw_errno("MetricsExporter: socket");
+    }
+
+    int result;
+    if (unix_socket)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (m_endpoint.path.size() >= sizeof(addr.sun_path))
+        {
+            ::close(m_listen_fd);
+            throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                                    "MetricsExporter: " + m_endpoint.path);
+        }
+        std::strcpy(addr.sun_path, m_endpoint.path.c_str());
+        struct stat existing;
+        if (::lstat(addr.sun_path, &existing) == 0)
+        {
+            if (!S_ISSOCK(existing.st_mode))
+            {
+                ::close(m_listen_fd);
+                throw std::system_error(EEXIST, std::generic_category(),
+                                        "MetricsExporter: not a socket: " + m_endpoint.path);
+            }
+            ::unlink(addr.sun_path);  // Left behind by a previous run
+        }
+        result = ::bind(m_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    else
+    {
+        const int reuse = 1;
+        ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(m_endpoint.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = ::bind(m_listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+    if (result != 0 || ::listen(m_listen_fd, backlog) != 0
+        || ::pipe2(m_wake_pipe, O_CLOEXEC) != 0)
+    {
+        const int error = errno;
+        ::close(m_listen_fd);
+        throw std::system_error(error, std::generic_category(), "MetricsExporter: bind/listen");
+    }
+
+    if (!unix_socket)
+    {
+        sockaddr_in bound{};
+        socklen_t   length = sizeof(bound);
+        ::getsockname(m_listen_fd, reinterpret_cast<sockaddr *>(&bound), &length);
+        m_port = ntohs(bound.sin_port);
+    }
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+    ::close(m_listen_fd);
+    ::close(m_wake_pipe[0]);
+    ::close(m_wake_pipe[1]);
+    if (!m_endpoint.path.empty())
+    {
+        ::unlink(m_endpoint.path.c_str());
+    }
+}
+
+void MetricsExporter::add_toaster(std::string name, std::shared_ptr<Toaster> toaster)
+{
+    std::scoped_lock<std::mutex> lock(m_toasters_mutex);
+    m_toasters.emplace_back(std::move(name), std::move(toaster));
+}
+
+void MetricsExporter::start()
+{
+    if (m_running.exchange(true))
+    {
+        return;
+    }
+    m_thread = std::thread(&MetricsExporter::serve, this);
+}
+
+void MetricsExporter::stop()
+{
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+    const char wake = 0;
+    (void)::write(m_wake_pipe[1], &wake, 1);
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void MetricsExporter::serve()
+{
+    pollfd fds[2] = {{m_listen_fd, POLLIN, 0}, {m_wake_pipe[0], POLLIN, 0}};
+    while (m_running)
+    {
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ASYNC_LOG_ERROR("MetricsExporter", "poll failed: {}", errno);
+            return;
+        }
+        if (fds[1].revents != 0)
+        {
+            return;
+        }
+        const int client = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            continue;
+        }
+        answer(client);
+        ::close(client);
+    }
+}
+
+void MetricsExporter::answer(int client) const
+{
+    // Whatever is asked for gets the metrics, the request is only drained up to its blank line
+    std::string request;
+    char        buffer[512];
+    pollfd      fd{client, POLLIN, 0};
+    while (request.size() < max_request_size && request.find("\r\n\r\n") == std::string::npos
+           && request.find("\n\n") == std::string::npos)
+    {
+        if (::poll(&fd, 1, request_timeout_ms) <= 0)
+        {
+            break;
+        }
+        const ssize_t received = ::recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    std::ostringstream body;
+    render(body);
+    const std::string content = body.str();
+
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             << "Content-Length: " << content.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << content;
+    const std::string text = response.str();
+    write_all(client, text.data(), text.size());
+}
+
+void MetricsExporter::render(std::ostream &os) const
+{
+    using tao::InternalEvent;
+    using tao::StateValue;
+
+    // All the toasters are sampled first, so each family can then be written in one block
+    std::vector<Sample> samples;
+    {
+        std::scoped_lock<std::mutex> lock(m_toasters_mutex);
+        samples.reserve(m_toasters.size());
+        for (const auto &[name, toaster] : m_toasters)
+        {
+            samples.push_back(Sample{name, toaster->queue_depth(), toaster->m_metrics.snapshot(),
+                                     toaster->timer_lateness(), toaster->thread_cpu_time()});
+        }
+    }
+
+    const auto label = [&](const Sample &sample)
+    { return "toaster=\"" + escape(sample.name) + "\""; };
+
+    family(os, "toaster_queue_depth", "gauge", "Events waiting in the toaster queue.");
+    for (const Sample &sample : samples)
+    {
+        os << "toaster_queue_depth{" << label(sample) << "} " << sample.queue_depth << '\n';
+    }
+
+    family(os, "toaster_events_total", "counter", "Events dispatched to the state machine.");
+    for (const Sample &sample : samples)
+    {
+        for (int e = 0; e < static_cast<int>(InternalEvent::evt_max); e++)
+        {
+            const auto event = static_cast<InternalEvent>(e);
+            os << "toaster_events_total{" << label(sample) << ",event=\""
+               << tao::stringify(event) << "\"} " << sample.metrics.event(event).count << '\n';
+        }
+    }
+
+    family(os, "toaster_event_latency_seconds", "summary",
+           "Time taken to handle an event, transitions included.");
+    for (const Sample &sample : samples)
+    {
+        for (int e = 0; e < static_cast<int>(InternalEvent::evt_max); e++)
+        {
+            const auto               event   = static_cast<InternalEvent>(e);
+            const tao::EventMetrics &metrics = sample.metrics.event(event);
+            if (metrics.count == 0)
+            {
+                continue;
+            }
+            const std::string labels = label(sample) + ",event=\"" + tao::stringify(event) + "\"";
+            for (double q : {0.5, 0.9, 0.99})
+            {
+                os << "toaster_event_latency_seconds{" << labels << ",quantile=\"" << q << "\"} "
+                   << seconds(metrics.latency.percentile(q)) << '\n';
+            }
+            os << "toaster_event_latency_seconds_sum{" << labels << "} "
+               << seconds(metrics.total_ns) << '\n';
+            os << "toaster_event_latency_seconds_count{" << labels << "} " << metrics.count
+               << '\n';
+        }
+    }
+
+    family(os, "toaster_dispatch_latency_seconds", "summary",
+           "Time from an event being queued to the end of its transition.");
+    for (const Sample &sample : samples)
+    {
+        const tao::EventMetrics &dispatch = sample.metrics.dispatch;
+        for (double q : {0.5, 0.9, 0.99})
+        {
+            os << "toaster_dispatch_latency_seconds{" << label(sample) << ",quantile=\"" << q
+               << "\"} " << seconds(dispatch.latency.percentile(q)) << '\n';
+        }
+        os << "toaster_dispatch_latency_seconds_sum{" << label(sample) << "} "
+           << seconds(dispatch.total_ns) << '\n';
+        os << "toaster_dispatch_latency_seconds_count{" << label(sample) << "} " << dispatch.count
+           << '\n';
+    }
+
+    family(os, "toaster_unhandled_events_total", "counter", "Events no state had a use for.");
+    for (const Sample &sample : samples)
+    {
+        os << "toaster_unhandled_events_total{" << label(sample) << "} "
+           << sample.metrics.unhandled_events << '\n';
+    }
+
+    family(os, "toaster_state_entries_total", "counter", "Times each state was entered.");
+    for (const Sample &sample : samples)
+    {
+        for (int s = 1; s < static_cast<int>(tao::state_count); s++)
+        {
+            const auto state = static_cast<StateValue>(s);
+            os << "toaster_state_entries_total{" << label(sample) << ",state=\""
+               << tao::stringify(state) << "\"} " << sample.metrics.state(state).entries << '\n';
+        }
+    }
+
+    family(os, "toaster_state_dwell_seconds_total", "counter",
+           "Time spent in each state, current stay included.");
+    for (const Sample &sample : samples)
+    {
+        for (int s = 1; s < static_cast<int>(tao::state_count); s++)
+        {
+            const auto state = static_cast<StateValue>(s);
+            os << "toaster_state_dwell_seconds_total{" << label(sample) << ",state=\""
+               << tao::stringify(state) << "\"} " << seconds(sample.metrics.state(state).dwell_ns)
+               << '\n';
+        }
+    }
+
+    family(os, "toaster_timer_expirations_total", "counter", "Expirations of the toaster timer.");
+    for (const Sample &sample : samples)
+    {
+        os << "toaster_timer_expirations_total{" << label(sample) << "} "
+           << sample.lateness.expirations << '\n';
+    }
+
+    family(os, "toaster_timer_lateness_seconds_total", "counter",
+           "Time by which timer callbacks ran after their deadline, summed.");
+    for (const Sample &sample : samples)
+    {
+        os << "toaster_timer_lateness_seconds_total{" << label(sample) << "} "
+           << seconds(sample.lateness.total_ns) << '\n';
+    }
+
+    family(os, "toaster_timer_lateness_max_seconds", "gauge",
+           "Worst time by which a timer callback ran after its deadline.");
+    for (const Sample &sample : samples)
+    {
+        os << "toaster_timer_lateness_max_seconds{" << label(sample) << "} "
+           << seconds(sample.lateness.max_ns) << '\n';
+    }
+
+    family(os, "toaster_thread_cpu_seconds_total", "counter",
+           "CPU time used by the toaster thread.");
+    for (const Sample &sample : samples)
+    {
+        if (sample.cpu_time)
+        {
+            os << "toaster_thread_cpu_seconds_total{" << label(sample) << "} "
+               << seconds(static_cast<std::uint64_t>(sample.cpu_time->count())) << '\n';
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef __METRICSEXPORTER__
+#define __METRICSEXPORTER__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ToasterActiveObject.hpp"
+
+/* Serves the metrics of a set of toasters in the Prometheus text format (version 0.0.4), over
+HTTP on a localhost TCP port or a Unix domain socket, from a thread of its own. Every scrape builds
+its snapshot from the toasters' lock free counters (ToasterMetrics, queue size, timer lateness,
+thread CPU clock), so it never blocks nor slows down their event loops.
+
+The constructor throws std::system_error when the endpoint can't be listened on: TCP port in use,
+socket path too long, or a path naming something other than a socket. A socket a previous
+exporter left at that path is replaced. */
+class MetricsExporter
+{
+   public:
+    struct Endpoint
+    {
+        static Endpoint tcp(std::uint16_t port)  // Bound to 127.0.0.1, 0 picks a free port
+        {
+            return Endpoint{port, {}};
+        }
+        static Endpoint unix_socket(std::string path)
+        {
+            return Endpoint{0, std::move(path)};
+        }
+
+        std::uint16_t port;
+        std::string   path;  // Unix domain socket when not empty
+    };
+
+    explicit MetricsExporter(Endpoint endpoint);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter &)            = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    // name ends up in the toaster="..." label of every sample
+    void add_toaster(std::string name, std::shared_ptr<Toaster> toaster);
+
+    void start();
+    void stop();
+
+    // Port actually listened to in TCP mode
+    std::uint16_t port() const
+    {
+        return m_port;
+    }
+
+    // What a scrape gets, minus the HTTP header
+    void render(std::ostream &os) const;
+
+   private:
+    void serve();
+    void answer(int client) const;
+
+    using Registry = std::vector<std::pair<std::string, std::shared_ptr<Toaster>>>;
+
+    Endpoint           m_endpoint;
+    int                m_listen_fd{-1};
+    int                m_wake_pipe[2]{-1, -1};  // Wakes serve() up on stop()
+    std::uint16_t      m_port{0};
+    std::atomic<bool>  m_running{false};
+    std::thread        m_thread;
+    mutable std::mutex m_toasters_mutex;  // Guards the registry only, never a toaster
+    Registry           m_toasters;
+};
+
+#endif
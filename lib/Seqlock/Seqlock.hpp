@@ -0,0 +1,81 @@
+#ifndef __SEQLOCK__
+#define __SEQLOCK__
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/* Single writer sequence lock. The writer never waits for anybody and readers never block the
+writer: a reader that raced with a write simply reads again. Only meant for data that is copied
+bytewise (trivially copyable), readers must not follow pointers read inside read(). */
+class Seqlock
+{
+   public:
+    template <typename F>
+    void write(F &&writer)
+    {
+        const std::uint64_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        writer();
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    template <typename F>
+    void read(F &&reader) const
+    {
+        while (true)
+        {
+            const std::uint64_t before = m_seq.load(std::memory_order_acquire);
+            if ((before & 1) == 0)
+            {
+                reader();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq.load(std::memory_order_relaxed) == before)
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    std::uint64_t sequence() const
+    {
+        return m_seq.load(std::memory_order_acquire);
+    }
+
+   private:
+    std::atomic<std::uint64_t> m_seq{0};
+};
+
+// A value published by one thread and snapshotted by any number of others without locking
+template <typename T>
+class SeqlockValue
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockValue needs a trivially copyable T");
+
+   public:
+    SeqlockValue() = default;
+    explicit SeqlockValue(const T &value) : m_value{value}
+    {
+    }
+
+    void store(const T &value)
+    {
+        m_lock.write([&]() { std::memcpy(&m_value, &value, sizeof(T)); });
+    }
+
+    T load() const
+    {
+        T result;
+        m_lock.read([&]() { std::memcpy(&result, &m_value, sizeof(T)); });
+        return result;
+    }
+
+   private:
+    Seqlock m_lock;
+    T       m_value{};
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include <cmath>
+
+#include "ThermalModel.hpp"
+
+ThermalSimulation::ThermalModel::ThermalModel(const Params &params)
+    : m_params{params},
+      m_decay{static_cast<float>(std::exp(-static_cast<double>(params.loss_coefficient)
+                                          * std::chrono::duration<double>(params.step).count()
+                                          / params.heat_capacity))},
+      m_temp{params.ambient_temp}
+{
+}
+
+float ThermalSimulation::ThermalModel::equilibrium_temperature() const
+{
+    const float power = m_heater_on ? m_params.heater_power : 0.0f;
+    return m_params.ambient_temp + power / m_params.loss_coefficient;
+}
+
+void ThermalSimulation::ThermalModel::step()
+{
+    const float t_eq = equilibrium_temperature();
+    m_temp           = t_eq + (m_temp - t_eq) * m_decay;
+}
+
+void ThermalSimulation::ThermalModel::advance(std::uint64_t steps)
+{
+    // n steps of the exact solution collapse into a single one with decay^n
+    const float t_eq = equilibrium_temperature();
+    m_temp = t_eq + (m_temp - t_eq) * static_cast<float>(std::pow(m_decay, steps));
+}
+
+std::uint64_t ThermalSimulation::ThermalModel::advance_for(std::chrono::nanoseconds elapsed)
+{
+    m_pending += elapsed;
+    const std::uint64_t steps = m_pending / m_params.step;
+    m_pending -= steps * std::chrono::duration_cast<std::chrono::nanoseconds>(m_params.step);
+    advance(steps);
+    return steps;
+}
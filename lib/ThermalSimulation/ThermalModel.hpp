@@ -0,0 +1,73 @@
+#ifndef __THERMALMODEL__
+#define __THERMALMODEL__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ThermalSimulation
+{
+
+struct ThermalModelParams
+{
+    float                     heat_capacity{500.0f};   // C, J/K
+    float                     heater_power{300.0f};    // P, W
+    float                     loss_coefficient{5.0f};  // k, W/K
+    float                     ambient_temp{25.0f};     // T_ambient, Celsius
+    std::chrono::microseconds step{1000};              // 1 kHz
+};
+
+/* Heater and enclosure seen as a single lumped mass losing heat to the ambient air (Newton's law
+of cooling):
+
+    C * dT/dt = P * heater_on - k * (T - T_ambient)
+
+It is advanced by fixed steps, each integrated exactly for a constant heater state, so the result
+only depends on the step and not on how often the caller gets to run. advance() runs any number of
+steps at once, which lets closed loop tests go through minutes of heating in a few milliseconds. */
+class ThermalModel
+{
+   public:
+    using Params = ThermalModelParams;
+
+    explicit ThermalModel(const Params &params = Params{});
+
+    void set_heater(bool on)
+    {
+        m_heater_on = on;
+    }
+    bool heater() const
+    {
+        return m_heater_on;
+    }
+    float temperature() const
+    {
+        return m_temp;
+    }
+    void set_temperature(float temp)
+    {
+        m_temp = temp;
+    }
+    const Params &params() const
+    {
+        return m_params;
+    }
+    // Temperature the model converges to with the heater in its current state
+    float equilibrium_temperature() const;
+
+    void step();
+    void advance(std::uint64_t steps);
+    // Runs as many whole steps as fit in elapsed (plus what was left over last time)
+    std::uint64_t advance_for(std::chrono::nanoseconds elapsed);
+
+   private:
+    Params                   m_params;
+    float                    m_decay;  // exp(-k * step / C)
+    float                    m_temp;
+    bool                     m_heater_on{false};
+    std::chrono::nanoseconds m_pending{0};
+};
+
+}  // namespace ThermalSimulation
+
+#endif
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "ThermalSimulation.hpp"
+
+namespace
+{
+// Classification of a slot: -1 below target, 0 target reached, 1 above target
+constexpr std::int8_t never_published = 2;
+
+TempSensorEvtType to_event(std::int8_t classification)
+{
+    switch (classification)
+    {
+        case -1:
+            return TempSensorEvtType::temp_below_target;
+        case 0:
+            return TempSensorEvtType::target_temp_reached;
+        case 1:
+            return TempSensorEvtType::temp_above_target;
+        default:
+            return TempSensorEvtType::unknown;
+    }
+}
+}  // namespace
+
+/* *************************************************************************************************
+Implementations of ThermalSimulation::FleetEngine
+************************************************************************************************* */
+
+ThermalSimulation::FleetEngine::FleetEngine(std::size_t capacity, float ambient_temp,
+                                            float max_temp, float step)
+    : m_ambient_temp{ambient_temp}, m_max_temp{max_temp}, m_step{step}
+{
+    m_heater_on.reserve(capacity);
+    m_temp.reserve(capacity);
+    m_target_temp.reserve(capacity);
+    m_error.reserve(capacity);
+    m_hysteresis.reserve(capacity);
+    m_class.reserve(capacity);
+    m_published_class.reserve(capacity);
+    m_sensor_callbacks.reserve(capacity);
+    m_crossings.reserve(capacity);
+}
+
+ThermalSimulation::FleetEngine::slot_t ThermalSimulation::FleetEngine::add_slot(float error)
+{
+    if (m_temp.size() == m_temp.capacity())
+    {
+        throw std::length_error("FleetEngine: no slot left");
+    }
+    m_heater_on.push_back(0);
+    m_temp.push_back(m_ambient_temp);
+    m_target_temp.push_back(m_ambient_temp);
+    m_error.push_back(error);
+    m_hysteresis.push_back(0.0f);
+    m_class.push_back(never_published);
+    m_published_class.push_back(never_published);
+    m_sensor_callbacks.emplace_back();
+    return static_cast<slot_t>(m_temp.size() - 1);
+}
+
+void ThermalSimulation::FleetEngine::set_heater(slot_t slot, bool on)
+{
+    m_heater_on[slot] = on ? 1 : 0;
+}
+
+bool ThermalSimulation::FleetEngine::heater(slot_t slot) const
+{
+    return m_heater_on[slot] != 0;
+}
+
+float ThermalSimulation::FleetEngine::temperature(slot_t slot) const
+{
+    return m_temp[slot];
+}
+
+void ThermalSimulation::FleetEngine::set_target_temperature(slot_t slot, float temp)
+{
+    if (m_target_temp[slot] == temp)
+    {
+        return;
+    }
+    m_target_temp[slot] = temp;
+    // The class published was against the old target: the next tick publishes again, whatever
+    m_class[slot]           = never_published;
+    m_published_class[slot] = never_published;
+}
+
+float ThermalSimulation::FleetEngine::target_temperature(slot_t slot) const
+{
+    return m_target_temp[slot];
+}
+
+void ThermalSimulation::FleetEngine::set_error(slot_t slot, float error)
+{
+    m_error[slot] = error;
+}
+
+void ThermalSimulation::FleetEngine::set_hysteresis(slot_t slot, float hysteresis)
+{
+    m_hysteresis[slot] = hysteresis;
+}
+
+void ThermalSimulation::FleetEngine::set_sensor_callback(slot_t slot, SensorCallback cb)
+{
+    m_sensor_callbacks[slot] = std::move(cb);
+}
+
+void ThermalSimulation::FleetEngine::set_crossings_handler(CrossingsHandler handler)
+{
+    m_crossings_handler = std::move(handler);
+}
+
+void ThermalSimulation::FleetEngine::tick()
+{
+    const std::size_t   n         = m_temp.size();
+    const std::uint8_t *heater_on = m_heater_on.data();
+    const float        *target    = m_target_temp.data();
+    const float        *error     = m_error.data();
+    const float        *hyst      = m_hysteresis.data();
+    float              *temp      = m_temp.data();
+    std::int8_t        *cls       = m_class.data();
+
+    // Same physics as DemoObjects::HeaterDemo: one step towards max when on, towards ambient when
+    // off. Kept free of branches and of calls so it vectorizes
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const float delta = m_step * (2.0f * static_cast<float>(heater_on[i]) - 1.0f);
+        const float t     = std::min(std::max(temp[i] + delta, m_ambient_temp), m_max_temp);
+        temp[i]           = t;
+
+        // Leaving the previous class costs an extra hysteresis on the boundary being crossed
+        const std::int8_t prev  = cls[i];
+        const float       known = prev != never_published ? 1.0f : 0.0f;
+        const float lower = target[i] - error[i] + known * hyst[i] * (prev == -1 ? 1.0f : -1.0f);
+        const float upper = target[i] + error[i] + known * hyst[i] * (prev == 1 ? -1.0f : 1.0f);
+        cls[i]            = static_cast<std::int8_t>((t >= upper) - (t <= lower));
+    }
+
+    m_crossings.clear();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (cls[i] != m_published_class[i])
+        {
+            m_published_class[i] = cls[i];
+            m_crossings.push_back(Crossing{static_cast<std::uint32_t>(i), to_event(cls[i])});
+        }
+    }
+
+    if (m_crossings.empty())
+    {
+        return;
+    }
+    if (m_crossings_handler)
+    {
+        m_crossings_handler(m_crossings.data(), m_crossings.size());
+    }
+    for (const auto &crossing : m_crossings)
+    {
+        const auto &cb = m_sensor_callbacks[crossing.slot];
+        if (cb)
+        {
+            cb(TempSensorEvent{crossing.event});
+        }
+    }
+}
+
+/* *************************************************************************************************
+Implementations of ThermalSimulation::SimulatedHeater
+************************************************************************************************* */
+
+ThermalSimulation::SimulatedHeater::SimulatedHeater(FleetEngine &engine, FleetEngine::slot_t slot)
+    : m_engine{engine}, m_slot{slot}
+{
+    m_status = Status::Off;
+}
+
+void ThermalSimulation::SimulatedHeater::turn_on()
+{
+    m_engine.set_heater(m_slot, true);
+}
+
+void ThermalSimulation::SimulatedHeater::turn_off()
+{
+    m_engine.set_heater(m_slot, false);
+}
+
+Actuators::IHeater::Status ThermalSimulation::SimulatedHeater::get_status() const
+{
+    return m_engine.heater(m_slot) ? Status::On : Status::Off;
+}
+
+/* *************************************************************************************************
+Implementations of ThermalSimulation::SimulatedTempSensor
+************************************************************************************************* */
+
+ThermalSimulation::SimulatedTempSensor::SimulatedTempSensor(FleetEngine        &engine,
+                                                            FleetEngine::slot_t slot)
+    : m_engine{engine}, m_slot{slot}
+{
+    m_status = Status::Off;
+}
+
+void ThermalSimulation::SimulatedTempSensor::initialize(SensorCallback cb)
+{
+    m_engine.set_sensor_callback(m_slot, std::move(cb));
+}
+
+void ThermalSimulation::SimulatedTempSensor::turn_on()
+{
+    m_status = Status::On;
+}
+
+void ThermalSimulation::SimulatedTempSensor::turn_off()
+{
+    m_status = Status::Off;
+}
+
+float ThermalSimulation::SimulatedTempSensor::get_temperature() const
+{
+    return m_engine.temperature(m_slot);
+}
+
+void ThermalSimulation::SimulatedTempSensor::set_target_temperature(float temp)
+{
+    m_engine.set_target_temperature(m_slot, temp);
+}
+
+Sensors::ITempSensor<ThermalSimulation::SensorCallback>::Status
+ThermalSimulation::SimulatedTempSensor::get_status() const
+{
+    return m_status;
+}
+
+void ThermalSimulation::SimulatedTempSensor::set_publish_policy(
+    const Sensors::PublishPolicy &policy)
+{
+    m_publish_policy = policy;
+    m_engine.set_hysteresis(m_slot, policy.hysteresis);
+}
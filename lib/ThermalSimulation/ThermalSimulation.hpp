@@ -0,0 +1,117 @@
+#ifndef __THERMALSIMULATION__
+#define __THERMALSIMULATION__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Actuators.hpp"
+#include "Sensors.hpp"
+#include "Events.hpp"
+
+namespace ThermalSimulation
+{
+
+using SensorCallback = std::function<void(const TempSensorEvent &)>;
+
+struct Crossing
+{
+    std::uint32_t     slot;
+    TempSensorEvtType event;
+};
+
+/* Simulates the heater and the temperature inside N independent toasters. Every per-toaster value
+lives in its own contiguous array (structure of arrays) so tick() advances the whole fleet in one
+branch-free loop the compiler can vectorize, then reports every classification change in bulk.
+Slots always publish edge-triggered, with the same hysteresis rule as Sensors::TempClassifier.
+Not thread safe: tick() and the adapters below must be used from the same thread (for instance
+toasters in executor mode sharing the io_context the ticks are posted to). */
+class FleetEngine
+{
+   public:
+    using slot_t           = std::uint32_t;
+    using CrossingsHandler = std::function<void(const Crossing *crossings, std::size_t count)>;
+
+    FleetEngine(std::size_t capacity, float ambient_temp = 25.0f, float max_temp = 80.0f,
+                float step = 1.0f);
+
+    slot_t      add_slot(float error = 2.0f);
+    std::size_t size() const
+    {
+        return m_temp.size();
+    }
+
+    void  set_heater(slot_t slot, bool on);
+    bool  heater(slot_t slot) const;
+    float temperature(slot_t slot) const;
+    void  set_target_temperature(slot_t slot, float temp);
+    float target_temperature(slot_t slot) const;
+    void  set_error(slot_t slot, float error);
+    void  set_hysteresis(slot_t slot, float hysteresis);
+
+    // Per-slot delivery, used by SimulatedTempSensor
+    void set_sensor_callback(slot_t slot, SensorCallback cb);
+    // Whole-fleet delivery, called once per tick with every crossing of that tick
+    void set_crossings_handler(CrossingsHandler handler);
+
+    void                         tick();
+    const std::vector<Crossing> &last_crossings() const
+    {
+        return m_crossings;
+    }
+
+   private:
+    float m_ambient_temp;
+    float m_max_temp;
+    float m_step;
+
+    std::vector<std::uint8_t> m_heater_on;
+    std::vector<float>        m_temp;
+    std::vector<float>        m_target_temp;
+    std::vector<float>        m_error;
+    std::vector<float>        m_hysteresis;
+    std::vector<std::int8_t>  m_class;
+    std::vector<std::int8_t>  m_published_class;
+
+    std::vector<SensorCallback> m_sensor_callbacks;
+    CrossingsHandler            m_crossings_handler;
+    std::vector<Crossing>       m_crossings;
+};
+
+class SimulatedHeater : public Actuators::IHeater
+{
+   public:
+    SimulatedHeater(FleetEngine &engine, FleetEngine::slot_t slot);
+
+    void   turn_on() override;
+    void   turn_off() override;
+    Status get_status() const override;
+
+   private:
+    FleetEngine        &m_engine;
+    FleetEngine::slot_t m_slot;
+};
+
+class SimulatedTempSensor : public Sensors::ITempSensor<SensorCallback>
+{
+   public:
+    SimulatedTempSensor(FleetEngine &engine, FleetEngine::slot_t slot);
+
+    void   initialize(SensorCallback cb) override;
+    void   turn_on() override;
+    void   turn_off() override;
+    float  get_temperature() const override;
+    void   set_target_temperature(float temp) override;
+    Status get_status() const override;
+    // Only the hysteresis is honored: slots are always edge-triggered and never rate limited
+    void   set_publish_policy(const Sensors::PublishPolicy &policy) override;
+
+   private:
+    FleetEngine        &m_engine;
+    FleetEngine::slot_t m_slot;
+};
+
+}  // namespace ThermalSimulation
+
+#endif
@@ -4,12 +4,9 @@
 
 #include "ThreadSafeQueue.hpp"
 
-std::shared_ptr<spdlog::logger> myLogger = spdlog::stdout_color_mt("ThreadSafeQueue");
-
 void test_queue()
 {
-    spdlog::set_pattern("[%H:%M:%S:%e][%n][%^%l%$][thread_id=%t] %v");
-    spdlog::set_level(spdlog::level::debug);
+    AsyncLogger::set_level(AsyncLogger::Level::debug);
 
     std::shared_ptr<IThreadSafeQueue<int>> queue = std::make_shared<SimplestThreadSafeQueue<int>>();
     auto t1    = std::thread(&IThreadSafeQueue<int>::wait_and_pop, queue.get());
@@ -19,9 +16,12 @@ void test_queue()
     auto data2 = int{82};
     auto data3 = int{83};
     std::this_thread::sleep_for(std::chrono::seconds(1));
-    myLogger->debug("[test_queue()] Producing data in main thread: {0:d}", data1);
-    myLogger->debug("[test_queue()] Producing data in main thread: {0:d}", data2);
-    myLogger->debug("[test_queue()] Producing data in main thread: {0:d}", data3);
+    ASYNC_LOG_DEBUG("ThreadSafeQueue", "[test_queue()] Producing data in main thread: {0:d}",
+                    data1);
+    ASYNC_LOG_DEBUG("ThreadSafeQueue", "[test_queue()] Producing data in main thread: {0:d}",
+                    data2);
+    ASYNC_LOG_DEBUG("ThreadSafeQueue", "[test_queue()] Producing data in main thread: {0:d}",
+                    data3);
     queue->put(std::move(data1));
     queue->put(std::move(data2));
     queue->put_prioritized(std::move(data3));
@@ -1,6 +1,7 @@
 #ifndef __THREADSAFEQUEUE__
 #define __THREADSAFEQUEUE__
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -8,21 +9,27 @@
 #include <chrono>
 #include <memory>
 #include <thread>
+#include <vector>
 
-#include "spdlog/spdlog.h"
-#include "spdlog/sinks/stdout_color_sinks.h"
-
-extern std::shared_ptr<spdlog::logger> myLogger;
+#include "AsyncLogger.hpp"
 
 template <typename T>
 class IThreadSafeQueue
 {
    public:
+    using value_type = T;
+
     virtual void               put(T &&element)                                           = 0;
     virtual void               put_prioritized(T &&element)                               = 0;
+    // Moves the elements to the back of the queue in one go, leaves elements empty
+    virtual void               put_batch(std::vector<T> &elements)                        = 0;
     virtual std::shared_ptr<T> wait_and_pop()                                             = 0;
     virtual std::shared_ptr<T> wait_and_pop_for(const std::chrono::milliseconds &timeout) = 0;
     virtual bool               empty()                                                    = 0;
+    // Approximate when other threads are putting or popping, never blocks
+    virtual std::size_t        size() const                                               = 0;
+    // Copy of the queued elements, front first
+    virtual std::vector<T>     contents() const                                           = 0;
     virtual void               reset()                                                    = 0;
     virtual void               clear()                                                    = 0;
 
@@ -30,20 +37,22 @@ class IThreadSafeQueue
 };
 
 template <typename T>
-class SimplestThreadSafeQueue : public IThreadSafeQueue<T>
+class SimplestThreadSafeQueue final : public IThreadSafeQueue<T>
 {
    public:
     SimplestThreadSafeQueue()
     {
-        myLogger->debug("[SimplestThreadSafeQueue()]");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue", "[SimplestThreadSafeQueue()]");
     }
 
     virtual void put(T &&element) override
     {
         {
             std::scoped_lock<std::mutex> lock(m_mutex);
-            myLogger->debug("[put(T &&element)] Putting element in back of queue");
+            ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                            "[put(T &&element)] Putting element in back of queue");
             m_queue.push_back(std::forward<T>(element));
+            m_size.store(m_queue.size(), std::memory_order_relaxed);
         }
         m_cv.notify_all();
     }
@@ -51,9 +60,26 @@ class SimplestThreadSafeQueue : public IThreadSafeQueue<T>
     {
         {
             std::scoped_lock<std::mutex> lock(m_mutex);
-            myLogger->debug("[put_prioritized(T &&element)] Putting element in front of queue");
+            ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                            "[put_prioritized(T &&element)] Putting element in front of queue");
             m_queue.push_front(std::forward<T>(element));
+            m_size.store(m_queue.size(), std::memory_order_relaxed);
+        }
+        m_cv.notify_all();
+    }
+    virtual void put_batch(std::vector<T> &elements) override
+    {
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                            "[put_batch(std::vector<T> &elements)] Putting {} elements in back of "
+                            "queue",
+                            elements.size());
+            for (auto &element : elements)
+                m_queue.push_back(std::move(element));
+            m_size.store(m_queue.size(), std::memory_order_relaxed);
         }
+        elements.clear();
         m_cv.notify_all();
     }
     // Wait without a timeout
@@ -61,22 +87,26 @@ class SimplestThreadSafeQueue : public IThreadSafeQueue<T>
     {
         std::shared_ptr<T>           result;
         std::unique_lock<std::mutex> lock(m_mutex);
-        myLogger->debug("[wait_and_pop()] Waiting for data in background");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue", "[wait_and_pop()] Waiting for data in background");
         m_cv.wait(lock,
                   [&]()
                   {
-                      myLogger->debug("[wait_and_pop()] Checking wait predicate: ",
+                      ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                                      "[wait_and_pop()] Checking wait predicate: {}",
                                       (!m_queue.empty()));
                       return !m_queue.empty();
                   });
-        myLogger->debug("[wait_and_pop()] Finished waiting for data in background");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                        "[wait_and_pop()] Finished waiting for data in background");
         result = std::make_shared<T>(std::move(m_queue.front()));
         m_queue.pop_front();
+        m_size.store(m_queue.size(), std::memory_order_relaxed);
         if (result == nullptr)
         {
-            myLogger->warn("[wait_and_pop()] nullptr result");
+            ASYNC_LOG_WARN("ThreadSafeQueue", "[wait_and_pop()] nullptr result");
         }
-        myLogger->debug("[wait_and_pop()] Consuming data in background thread");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                        "[wait_and_pop()] Consuming data in background thread");
         lock.unlock();
         return result;
     }
@@ -89,27 +119,33 @@ class SimplestThreadSafeQueue : public IThreadSafeQueue<T>
         timeout is represented by a nullptr shared_ptr */
         std::shared_ptr<T>           result;
         std::unique_lock<std::mutex> lock(m_mutex);
-        myLogger->debug("[wait_and_pop_for(const std::chrono...] Waiting for data in background");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue",
+                        "[wait_and_pop_for(const std::chrono...] Waiting for data in background");
         /*  The return of wait_for is false if it returns and the predicate is still false */
         if (m_cv.wait_for(
                 lock, timeout,
                 [&]()
                 {
-                    myLogger->debug(
-                        "[wait_and_pop_for(const std::chrono...] Checking wait predicate: ",
+                    ASYNC_LOG_DEBUG(
+                        "ThreadSafeQueue",
+                        "[wait_and_pop_for(const std::chrono...] Checking wait predicate: {}",
                         (!m_queue.empty()));
                     return !m_queue.empty();
                 }))
         {
-            myLogger->debug(
+            ASYNC_LOG_DEBUG(
+                "ThreadSafeQueue",
                 "[wait_and_pop_for(const std::chrono...] Finished waiting for data in background");
             result = std::make_shared<T>(std::move(m_queue.front()));
             m_queue.pop_front();
+            m_size.store(m_queue.size(), std::memory_order_relaxed);
             if (result == nullptr)
             {
-                myLogger->warn("[wait_and_pop_for(const std::chrono...] nullptr result");
+                ASYNC_LOG_WARN("ThreadSafeQueue",
+                               "[wait_and_pop_for(const std::chrono...] nullptr result");
             }
-            myLogger->debug(
+            ASYNC_LOG_DEBUG(
+                "ThreadSafeQueue",
                 "[wait_and_pop_for(const std::chrono...] Consuming data in background thread");
             lock.unlock();
         }
@@ -117,7 +153,7 @@ class SimplestThreadSafeQueue : public IThreadSafeQueue<T>
     }
     virtual bool empty() override
     {
-        myLogger->debug("[empty()]");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue", "[empty()]");
         bool result;
         {
             std::scoped_lock<std::mutex> lock(m_mutex);
@@ -125,21 +161,33 @@ class SimplestThreadSafeQueue : public IThreadSafeQueue<T>
         }
         return result;
     }
+    virtual std::size_t size() const override
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+    virtual std::vector<T> contents() const override
+    {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return std::vector<T>(m_queue.begin(), m_queue.end());
+    }
     virtual void reset() override
     {
-        myLogger->debug("[reset()]");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue", "[reset()]");
         m_queue = std::deque<T>{};
+        m_size.store(0, std::memory_order_relaxed);
     }
     virtual void clear() override
     {
-        myLogger->debug("[clear()]");
+        ASYNC_LOG_DEBUG("ThreadSafeQueue", "[clear()]");
         m_queue.clear();
+        m_size.store(0, std::memory_order_relaxed);
     }
 
    private:
-    std::deque<T>           m_queue{};
-    std::condition_variable m_cv;
-    std::mutex              m_mutex;
+    std::deque<T>            m_queue{};
+    std::atomic<std::size_t> m_size{0};
+    std::condition_variable  m_cv;
+    mutable std::mutex       m_mutex;
 };
 
 void test_queue();
@@ -1,6 +1,10 @@
 #ifndef __ACTUATORS__
 #define __ACTUATORS__
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+
 #include "Events.hpp"
 
 namespace Actuators
@@ -26,5 +30,60 @@ class IHeater
     Status m_status;
 };
 
+/* Output stage between the state machine and a heater. Commands only record the wanted status,
+flush() then applies the last one with a single write, and only when it differs from what the
+heater was last told. Meant to be flushed once at the end of every run-to-completion step, so
+redundant commands and commands undone within the same step never reach the hardware. */
+class HeaterOutputStage
+{
+   public:
+    void request(IHeater::Status status)
+    {
+        m_requested = status;
+        m_requests++;
+    }
+
+    /* Returns whether heater was actually written to. A template so that a toaster bound to a
+    concrete heater type calls it directly */
+    template <class Heater>
+    bool flush(Heater &heater)
+    {
+        if (!m_requested || m_requested == m_written)
+        {
+            return false;
+        }
+        if (*m_requested == IHeater::Status::On)
+        {
+            heater.turn_on();
+        }
+        else
+        {
+            heater.turn_off();
+        }
+        m_written = m_requested;
+        m_writes++;
+        return true;
+    }
+
+    std::optional<IHeater::Status> requested() const
+    {
+        return m_requested;
+    }
+    std::uint64_t requests() const
+    {
+        return m_requests;
+    }
+    std::uint64_t writes() const
+    {
+        return m_writes;
+    }
+
+   private:
+    std::optional<IHeater::Status> m_requested;
+    std::optional<IHeater::Status> m_written;  // Unknown until the first write
+    std::uint64_t                  m_requests{0};
+    std::uint64_t                  m_writes{0};
+};
+
 }  // namespace Actuators
 #endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <exception>
+
+#include "ToasterActiveObject.hpp"
+
+/* *************************************************************************************************
+Implementations of tao::FrameArena
+************************************************************************************************* */
+
+namespace
+{
+/* Every frame is prefixed with the arena it came from and its size: the placement operator delete
+only receives the pointer */
+struct FrameHeader
+{
+    alignas(std::max_align_t) tao::FrameArena *arena;
+    std::size_t size;
+};
+
+std::size_t round_up(std::size_t size)
+{
+    constexpr std::size_t align = alignof(std::max_align_t);
+    return (size + align - 1) / align * align;
+}
+}  // namespace
+
+void *tao::FrameArena::allocate(std::size_t size) noexcept
+{
+    size = round_up(size);
+    if (size > capacity - m_top)
+    {
+        return nullptr;
+    }
+    void *ptr = m_buffer + m_top;
+    m_top += size;
+    m_live++;
+    return ptr;
+}
+
+void tao::FrameArena::deallocate(void *ptr, std::size_t size) noexcept
+{
+    size = round_up(size);
+    m_live--;
+    if (m_live == 0)
+    {
+        m_top = 0;
+    }
+    else if (static_cast<std::byte *>(ptr) + size == m_buffer + m_top)
+    {
+        m_top -= size;
+    }
+}
+
+void *tao::allocate_program_frame(ToasterCore &toaster, std::size_t size) noexcept
+{
+    tao::FrameArena &arena = toaster.m_frame_arena;
+    void            *raw   = arena.allocate(sizeof(FrameHeader) + size);
+    if (raw == nullptr)
+    {
+        return nullptr;
+    }
+    static_cast<FrameHeader *>(raw)->arena = &arena;
+    static_cast<FrameHeader *>(raw)->size  = sizeof(FrameHeader) + size;
+    return static_cast<FrameHeader *>(raw) + 1;
+}
+
+void tao::release_program_frame(void *ptr) noexcept
+{
+    FrameHeader *header = static_cast<FrameHeader *>(ptr) - 1;
+    header->arena->deallocate(header, header->size);
+}
+
+/* *************************************************************************************************
+Implementations of tao::CookingProgram
+************************************************************************************************* */
+
+void tao::CookingProgram::promise_type::unhandled_exception()
+{
+    std::terminate();
+}
+
+bool tao::CookingProgram::awaits(InternalEvent evt) const
+{
+    return m_handle && !m_handle.done() && m_handle.promise().m_awaited == evt;
+}
+
+void tao::CookingProgram::resume()
+{
+    if (done())
+    {
+        return;
+    }
+    m_handle.promise().m_awaited = tao::InternalEvent::unknown;
+    m_handle.resume();
+}
+
+void tao::CookingProgram::reset()
+{
+    if (m_handle)
+    {
+        m_handle.destroy();
+        m_handle = nullptr;
+    }
+}
+
+/* *************************************************************************************************
+Implementations of tao::ProgramAwaiter
+************************************************************************************************* */
+
+void tao::ProgramAwaiter::await_suspend(std::coroutine_handle<CookingProgram::promise_type> handle)
+{
+    ToasterCore *toaster = handle.promise().m_toaster;
+    switch (m_action)
+    {
+        case Action::sleep:
+            toaster->disarm_time_event();
+            toaster->arm_time_event(static_cast<long>(m_value));
+            break;
+        case Action::heat:
+            toaster->set_target_temperature(static_cast<float>(m_value));
+            toaster->heater_on();
+            break;
+        default:
+            break;
+    }
+    handle.promise().m_awaited = m_resume_on;
+}
+
+tao::ProgramAwaiter tao::sleep_for(std::chrono::milliseconds duration)
+{
+    return ProgramAwaiter{ProgramAwaiter::Action::sleep, InternalEvent::evt_alarm_timeout,
+                          static_cast<double>(duration.count())};
+}
+
+tao::ProgramAwaiter tao::heat_until(float target_temp)
+{
+    return ProgramAwaiter{ProgramAwaiter::Action::heat, InternalEvent::evt_target_temp_reached,
+                          target_temp};
+}
+
+tao::ProgramAwaiter tao::wait_for(InternalEvent evt)
+{
+    return ProgramAwaiter{ProgramAwaiter::Action::none, evt};
+}
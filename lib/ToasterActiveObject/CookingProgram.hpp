@@ -0,0 +1,185 @@
+#ifndef __COOKINGPROGRAM__
+#define __COOKINGPROGRAM__
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <utility>
+
+// Forward declaration
+class ToasterCore;
+
+// namespace toaster active object - tao
+namespace tao
+{
+enum class InternalEvent;
+
+/* Fixed-size storage the coroutine frames of one Toaster are carved from, so running a cooking
+program never touches the global heap. Frames are handed out bump-allocator style and the arena
+rewinds once every frame was released. */
+class FrameArena
+{
+   public:
+    static constexpr std::size_t capacity = 1024;
+
+    void       *allocate(std::size_t size) noexcept;
+    void        deallocate(void *ptr, std::size_t size) noexcept;
+    std::size_t in_use() const
+    {
+        return m_top;
+    }
+
+   private:
+    alignas(std::max_align_t) std::byte m_buffer[capacity];
+    std::size_t m_top{0};
+    std::size_t m_live{0};
+};
+
+void *allocate_program_frame(ToasterCore &toaster, std::size_t size) noexcept;
+void  release_program_frame(void *ptr) noexcept;
+
+// Around a program definition: GCC wrongly pairs the frame's operator new / delete below
+#define TAO_COOKING_PROGRAM_BEGIN                                                                  \
+    _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmismatched-new-delete\"")
+#define TAO_COOKING_PROGRAM_END _Pragma("GCC diagnostic pop")
+
+/* Coroutine type of a cooking program. The coroutine must take the Toaster it runs on as its first
+parameter; it starts suspended and is resumed from Toaster::state_machine_iteration() every time
+the event it co_awaits is dispatched, i.e. directly from the event loop (or the timer handler in
+executor mode) without going through any state. */
+class CookingProgram
+{
+   public:
+    struct promise_type
+    {
+        template <typename... Args>
+        promise_type(ToasterCore &toaster, Args &&...) : m_toaster{&toaster}
+        {
+        }
+
+        template <typename... Args>
+        static void *operator new(std::size_t size, ToasterCore &toaster, Args &&...) noexcept
+        {
+            return allocate_program_frame(toaster, size);
+        }
+        static void operator delete(void *ptr, std::size_t) noexcept
+        {
+            release_program_frame(ptr);
+        }
+        // Matches operator new above, used if constructing the promise throws
+        template <typename... Args>
+        static void operator delete(void *ptr, ToasterCore &, Args &&...) noexcept
+        {
+            release_program_frame(ptr);
+        }
+
+        // The arena is full: an invalid program, ToasterCore::run_program() refuses it
+        static CookingProgram get_return_object_on_allocation_failure()
+        {
+            return CookingProgram{};
+        }
+        CookingProgram get_return_object()
+        {
+            return CookingProgram{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void()
+        {
+        }
+        void unhandled_exception();
+
+        ToasterCore  *m_toaster;
+        InternalEvent m_awaited{};
+    };
+
+    CookingProgram() = default;
+    CookingProgram(CookingProgram &&other) noexcept
+        : m_handle{std::exchange(other.m_handle, nullptr)}
+    {
+    }
+    CookingProgram &operator=(CookingProgram &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    CookingProgram(const CookingProgram &)            = delete;
+    CookingProgram &operator=(const CookingProgram &) = delete;
+    ~CookingProgram()
+    {
+        reset();
+    }
+
+    bool valid() const
+    {
+        return static_cast<bool>(m_handle);
+    }
+    bool done() const
+    {
+        return !m_handle || m_handle.done();
+    }
+    // True when the program is suspended waiting for evt
+    bool awaits(InternalEvent evt) const;
+    void resume();
+    void reset();
+
+   private:
+    explicit CookingProgram(std::coroutine_handle<promise_type> handle) : m_handle{handle}
+    {
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/* What a cooking program can co_await. The action (arming the alarm, changing the target
+temperature...) is performed on suspension, then the program sleeps until m_resume_on arrives */
+class ProgramAwaiter
+{
+   public:
+    enum class Action
+    {
+        none,
+        sleep,
+        heat,
+    };
+
+    ProgramAwaiter(Action action, InternalEvent resume_on, double value = 0)
+        : m_action{action}, m_resume_on{resume_on}, m_value{value}
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<CookingProgram::promise_type> handle);
+    void await_resume() const noexcept
+    {
+    }
+
+   private:
+    Action        m_action;
+    InternalEvent m_resume_on;
+    double        m_value;
+};
+
+// Arms the toaster alarm and resumes when it expires
+ProgramAwaiter sleep_for(std::chrono::milliseconds duration);
+// Sets the target temperature, turns the heater on and resumes once the sensor reports it reached
+ProgramAwaiter heat_until(float target_temp);
+// Resumes on the next occurrence of evt
+ProgramAwaiter wait_for(InternalEvent evt);
+
+}  // namespace tao
+
+#endif
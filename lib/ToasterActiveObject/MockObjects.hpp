@@ -0,0 +1,168 @@
+#ifndef __MOCKOBJECTS__
+#define __MOCKOBJECTS__
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+#include "Actuators.hpp"
+#include "Events.hpp"
+#include "Sensors.hpp"
+
+namespace MockObjects
+{
+
+/* Heater driving a file the way a sysfs GPIO "value" file is driven: every command rewrites "1"
+or "0" at its start. Counts the writes that really reached the file. */
+class FileHeater : public Actuators::IHeater
+{
+   public:
+    explicit FileHeater(const std::string &path)
+        : m_fd{::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)}
+    {
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("Could not open " + path);
+        }
+        m_status = Status::Off;
+    }
+
+    ~FileHeater()
+    {
+        ::close(m_fd);
+    }
+
+    FileHeater(const FileHeater &)            = delete;
+    FileHeater &operator=(const FileHeater &) = delete;
+
+    void turn_on() override
+    {
+        write_value('1');
+        m_status = Status::On;
+    }
+
+    void turn_off() override
+    {
+        write_value('0');
+        m_status = Status::Off;
+    }
+
+    std::uint64_t writes() const
+    {
+        return m_writes.load(std::memory_order_relaxed);
+    }
+
+   private:
+    void write_value(char value)
+    {
+        if (::pwrite(m_fd, &value, 1, 0) == 1)
+        {
+            m_writes.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    int                        m_fd;
+    std::atomic<std::uint64_t> m_writes{0};
+};
+
+/* Heater with no side effect and no thread, it only counts the commands it gets */
+class InertHeater final : public Actuators::IHeater
+{
+   public:
+    InertHeater()
+    {
+        m_status = Status::Off;
+    }
+
+    void turn_on() override
+    {
+        m_status = Status::On;
+        m_commands.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void turn_off() override
+    {
+        m_status = Status::Off;
+        m_commands.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t commands() const
+    {
+        return m_commands.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<std::uint64_t> m_commands{0};
+};
+
+/* Sensor with no timer and no thread: it never publishes anything by itself, events are injected
+with publish() from whichever thread drives the test or the benchmark */
+class InertSensor final : public Sensors::ITempSensor<std::function<void(const TempSensorEvent &)>>
+{
+   public:
+    InertSensor()
+    {
+        m_status      = Status::Off;
+        m_curr_temp   = 0.0f;
+        m_target_temp = 0.0f;
+    }
+
+    void initialize(std::function<void(const TempSensorEvent &)> cb) override
+    {
+        m_callback = std::move(cb);
+    }
+    void turn_on() override
+    {
+        m_status = Status::On;
+    }
+    void turn_off() override
+    {
+        m_status = Status::Off;
+    }
+    float get_temperature() const override
+    {
+        return m_curr_temp;
+    }
+    void set_target_temperature(float temp) override
+    {
+        m_target_temp = temp;
+    }
+    Status get_status() const override
+    {
+        return m_status;
+    }
+
+    float target_temperature() const
+    {
+        return m_target_temp;
+    }
+
+    void publish(TempSensorEvtType event)
+    {
+        m_callback(TempSensorEvent{event});
+    }
+
+    // A reading taken at the given time, the clock is the caller's
+    void record(float temp, Sensors::TempHistory::clock::time_point at)
+    {
+        m_curr_temp = temp;
+        m_history.push(temp, at);
+    }
+    const Sensors::TempHistory *history() const override
+    {
+        return &m_history;
+    }
+
+   private:
+    std::function<void(const TempSensorEvent &)> m_callback;
+    Sensors::TempHistory                         m_history{8};
+};
+
+}  // namespace MockObjects
+
+#endif
@@ -1,11 +1,123 @@
 #ifndef __SENSORS__
 #define __SENSORS__
 
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
 #include "Events.hpp"
+#include "TempHistory.hpp"
 
 namespace Sensors
 {
 
+// How a temperature sensor turns readings into TempSensorEvents
+struct PublishPolicy
+{
+    enum class Mode
+    {
+        level,  // An event on every reading
+        edge,   // An event only when the classification changes
+    };
+
+    Mode  mode{Mode::level};
+    float hysteresis{0.0f};  // Extra margin a reading must cross to leave its current class
+    std::chrono::milliseconds min_interval{0};  // Minimum time between two events, 0 disables it
+};
+
+/* Classifies readings as below / within / above target +- error and decides, according to a
+PublishPolicy, whether the reading must be published */
+class TempClassifier
+{
+   public:
+    using clock = std::chrono::steady_clock;
+
+    enum class Class : std::int8_t
+    {
+        unknown,
+        below,
+        reached,
+        above,
+    };
+
+    std::optional<TempSensorEvtType> update(float temp, float target, float error,
+                                            const PublishPolicy &policy, clock::time_point now)
+    {
+        m_current = classify(temp, target, error, policy.hysteresis);
+
+        if (policy.mode == PublishPolicy::Mode::edge && m_current == m_published)
+        {
+            return std::nullopt;
+        }
+        if (m_published != Class::unknown && now - m_published_at < policy.min_interval)
+        {
+            // Rate limited: a pending change is still seen as one on the next reading
+            return std::nullopt;
+        }
+        m_published    = m_current;
+        m_published_at = now;
+        return to_event(m_current);
+    }
+
+    // Forgets what was published, so the next reading is published whatever its class
+    void invalidate()
+    {
+        m_published = Class::unknown;
+    }
+
+    Class classify(float temp, float target, float error, float hysteresis) const
+    {
+        // Leaving the current class costs an extra hysteresis on the boundary being crossed
+        float lower = target - error;
+        float upper = target + error;
+        if (m_current == Class::below)
+        {
+            lower += hysteresis;
+            upper += hysteresis;
+        }
+        else if (m_current == Class::reached)
+        {
+            lower -= hysteresis;
+            upper += hysteresis;
+        }
+        else if (m_current == Class::above)
+        {
+            lower -= hysteresis;
+            upper -= hysteresis;
+        }
+
+        if (temp <= lower)
+        {
+            return Class::below;
+        }
+        if (temp >= upper)
+        {
+            return Class::above;
+        }
+        return Class::reached;
+    }
+
+    static TempSensorEvtType to_event(Class cls)
+    {
+        switch (cls)
+        {
+            case Class::below:
+                return TempSensorEvtType::temp_below_target;
+            case Class::reached:
+                return TempSensorEvtType::target_temp_reached;
+            case Class::above:
+                return TempSensorEvtType::temp_above_target;
+            default:
+                return TempSensorEvtType::unknown;
+        }
+    }
+
+   private:
+    Class             m_current{Class::unknown};
+    Class             m_published{Class::unknown};
+    clock::time_point m_published_at{};
+};
+
 template <typename callback>
 class ITempSensor
 {
@@ -23,12 +135,27 @@ class ITempSensor
     virtual void   set_target_temperature(float temp) = 0;
     virtual Status get_status() const                 = 0;
 
+    virtual void set_publish_policy(const PublishPolicy &policy)
+    {
+        m_publish_policy = policy;
+    }
+    virtual PublishPolicy get_publish_policy() const
+    {
+        return m_publish_policy;
+    }
+    // Recent readings, for sensors that keep them
+    virtual const TempHistory *history() const
+    {
+        return nullptr;
+    }
+
    protected:
-    Status m_status;
-    float  m_curr_temp;
-    float  m_target_temp;
+    Status        m_status;
+    float         m_curr_temp;
+    float         m_target_temp;
+    PublishPolicy m_publish_policy;
 };
 
 }  // namespace Sensors
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,168 @@
+#ifndef __TEMPHISTORY__
+#define __TEMPHISTORY__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "Seqlock.hpp"
+
+namespace Sensors
+{
+
+struct TempSample
+{
+    std::int64_t timestamp_ns;
+    float        temp;
+};
+
+struct TempStats
+{
+    std::size_t  count{0};  // Samples currently in the window
+    float        last{0.0f};
+    float        ema{0.0f};
+    float        min{0.0f};  // Over the window
+    float        max{0.0f};  // Over the window
+    float        rate_per_s{0.0f};  // Oldest to newest sample of the window
+    std::int64_t last_timestamp_ns{0};
+};
+
+/* Fixed capacity ring of the last readings of a sensor, with statistics kept up to date in O(1)
+on every push. Everything is allocated by the constructor. push() belongs to a single writer
+(the sensor), stats() and samples() can be called from any thread and never block it. */
+class TempHistory
+{
+   public:
+    using clock = std::chrono::steady_clock;
+
+    TempHistory(std::size_t capacity, float ema_alpha = 0.2f)
+        : m_capacity{std::max<std::size_t>(capacity, 2)},
+          m_alpha{ema_alpha},
+          m_ring{new TempSample[m_capacity]},
+          m_max_window{new std::uint64_t[m_capacity]},
+          m_min_window{new std::uint64_t[m_capacity]}
+    {
+    }
+
+    void push(float temp, clock::time_point now = clock::now())
+    {
+        const std::uint64_t seq = m_next_seq++;
+        const TempSample    sample{
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count(),
+            temp};
+
+        m_lock.write(
+            [&]()
+            {
+                m_ring[seq % m_capacity] = sample;
+                m_newest_seq             = seq;
+
+                // Monotonic windows: sequences of the samples that can still be the min / the max
+                expire(m_max_window.get(), m_max_head, m_max_tail, seq);
+                expire(m_min_window.get(), m_min_head, m_min_tail, seq);
+                while (m_max_head != m_max_tail
+                       && at(m_max_window[(m_max_tail - 1) % m_capacity]) <= temp)
+                    m_max_tail--;
+                while (m_min_head != m_min_tail
+                       && at(m_min_window[(m_min_tail - 1) % m_capacity]) >= temp)
+                    m_min_tail--;
+                m_max_window[m_max_tail++ % m_capacity] = seq;
+                m_min_window[m_min_tail++ % m_capacity] = seq;
+
+                m_stats.count = std::min<std::size_t>(seq + 1, m_capacity);
+                m_stats.ema   = seq == 0 ? temp : m_stats.ema + m_alpha * (temp - m_stats.ema);
+                m_stats.last  = temp;
+                m_stats.max   = at(m_max_window[m_max_head % m_capacity]);
+                m_stats.min   = at(m_min_window[m_min_head % m_capacity]);
+                m_stats.last_timestamp_ns = sample.timestamp_ns;
+
+                const TempSample &oldest = m_ring[(seq + 1 - m_stats.count) % m_capacity];
+                const double      dt_s   = (sample.timestamp_ns - oldest.timestamp_ns) * 1e-9;
+                m_stats.rate_per_s =
+                    dt_s > 0.0 ? static_cast<float>((temp - oldest.temp) / dt_s) : 0.0f;
+            });
+    }
+
+    TempStats stats() const
+    {
+        TempStats result;
+        m_lock.read([&]() { result = m_stats; });
+        return result;
+    }
+
+    // Copies up to max samples, oldest first, and returns how many were copied
+    std::size_t samples(TempSample *out, std::size_t max) const
+    {
+        std::size_t copied = 0;
+        m_lock.read(
+            [&]()
+            {
+                const std::size_t   count = std::min(m_stats.count, max);
+                const std::uint64_t first = m_newest_seq + 1 - count;
+                for (std::size_t i = 0; i < count; i++)
+                    out[i] = m_ring[(first + i) % m_capacity];
+                copied = count;
+            });
+        return copied;
+    }
+
+    /* Extrapolates the current rate of change to tell when target will be reached. Empty when the
+    temperature does not move towards it */
+    std::optional<std::chrono::milliseconds> time_to_reach(float target) const
+    {
+        const TempStats s     = stats();
+        const float     delta = target - s.last;
+        if (s.count == 0)
+        {
+            return std::nullopt;
+        }
+        if (std::fabs(delta) < 1e-3f)
+        {
+            return std::chrono::milliseconds(0);
+        }
+        if (s.rate_per_s == 0.0f || (delta > 0.0f) != (s.rate_per_s > 0.0f))
+        {
+            return std::nullopt;
+        }
+        return std::chrono::milliseconds(static_cast<long>(1000.0f * delta / s.rate_per_s));
+    }
+
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+   private:
+    float at(std::uint64_t seq) const
+    {
+        return m_ring[seq % m_capacity].temp;
+    }
+
+    void expire(std::uint64_t *window, std::uint64_t &head, std::uint64_t tail, std::uint64_t seq)
+    {
+        while (head != tail && window[head % m_capacity] + m_capacity <= seq)
+            head++;
+    }
+
+    const std::size_t                m_capacity;
+    const float                      m_alpha;
+    std::unique_ptr<TempSample[]>    m_ring;
+    std::unique_ptr<std::uint64_t[]> m_max_window;
+    std::unique_ptr<std::uint64_t[]> m_min_window;
+    std::uint64_t                    m_max_head{0};
+    std::uint64_t                    m_max_tail{0};
+    std::uint64_t                    m_min_head{0};
+    std::uint64_t                    m_min_tail{0};
+    std::uint64_t                    m_next_seq{0};
+    std::uint64_t                    m_newest_seq{0};
+    TempStats                        m_stats;
+    Seqlock                          m_lock;
+};
+
+}  // namespace Sensors
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 
 #include "ToasterActiveObject.hpp"
@@ -16,7 +17,7 @@ const std::string &tao::stringify(tao::InternalEvent event)
     return unknown_internal_event;
 }
 
-std::ostream &operator<<(std::ostream &os, const tao::InternalEvent &event)
+std::ostream &tao::operator<<(std::ostream &os, const tao::InternalEvent &event)
 {
     os << stringify(event);
     return os;
@@ -27,7 +28,7 @@ const std::string &tao::stringify(tao::StateValue event)
     return stringfier_StateValue[static_cast<int>(event)];
 }
 
-std::ostream &operator<<(std::ostream &os, const tao::StateValue &state)
+std::ostream &tao::operator<<(std::ostream &os, const tao::StateValue &state)
 {
     os << stringify(state);
     return os;
@@ -44,18 +45,19 @@ void tao::GenericToasterState::set_next_state(StateValue state)
 
 void tao::GenericToasterState::unhandled_event(InternalEvent event)
 {
-    // std::cout << "GenericToasterState::unhandled_event: " << stringify(event) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[GenericToasterState::unhandled_event] {}",
+                    stringify(event).c_str());
     switch (event)
     {
         case tao::InternalEvent::evt_stop:
             m_toaster->m_running = false;
             break;
         case tao::InternalEvent::evt_door_close:
-            m_toaster->m_door_status = Toaster::DoorStatus::closed;
+            m_toaster->m_door_status = ToasterCore::DoorStatus::closed;
             set_next_state(tao::StateValue::STATE_HEATING);
             break;
         case tao::InternalEvent::evt_door_open:
-            m_toaster->m_door_status = Toaster::DoorStatus::opened;
+            m_toaster->m_door_status = ToasterCore::DoorStatus::opened;
             set_next_state(tao::StateValue::STATE_DOOR_OPEN);
             break;
         case tao::InternalEvent::evt_temp_below_target:
@@ -65,7 +67,8 @@ void tao::GenericToasterState::unhandled_event(InternalEvent event)
             m_toaster->heater_off();
             break;
         default:
-            // std::cout << "Event not handled at all" << std::endl;
+            ASYNC_LOG_DEBUG("ToasterActiveObject", "Event not handled at all");
+            m_toaster->m_metrics.event_unhandled();
             break;
     }
 }
@@ -75,20 +78,22 @@ Implementations of tao::HeatingSuperState
 ************************************************************************************************* */
 void tao::HeatingSuperState::on_entry()
 {
-    // std::cout << "HeatingSuperState::on_entry" << std::endl;
-    m_toaster->set_target_temperature(DEMO_MAX_TEMP);
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[HeatingSuperState::on_entry]");
+    m_toaster->set_target_temperature(target_temperature());
     m_toaster->heater_on();
 }
 
 void tao::HeatingSuperState::unhandled_event(InternalEvent event)
 {
-    // std::cout << "HeatingSuperState::unhandled_event: " << stringify(event) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[HeatingSuperState::unhandled_event] {}",
+                    stringify(event).c_str());
     tao::GenericToasterState::unhandled_event(event);
 }
 
 void tao::HeatingSuperState::process_internal_event(InternalEvent event)
 {
-    // std::cout << "HeatingSuperState::process_internal_event: " << stringify(event) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[HeatingSuperState::process_internal_event] {}",
+                    stringify(event).c_str());
     switch (event)
     {
         case tao::InternalEvent::evt_do_toasting:
@@ -105,26 +110,69 @@ void tao::HeatingSuperState::process_internal_event(InternalEvent event)
 
 void tao::HeatingSuperState::on_exit()
 {
-    // std::cout << "HeatingSuperState::on_exit" << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[HeatingSuperState::on_exit]");
     m_toaster->set_target_temperature(DEMO_AMBIENT_TEMP);
     m_toaster->heater_off();
 }
 
+void tao::HeatingSuperState::enter_level(StateValue level)
+{
+    if (level == tao::StateValue::STATE_HEATING)
+    {
+        // Substates share the heating actions without running their own
+        HeatingSuperState::on_entry();
+        return;
+    }
+    on_entry();
+}
+
+void tao::HeatingSuperState::exit_level(StateValue level)
+{
+    if (level == tao::StateValue::STATE_HEATING)
+    {
+        HeatingSuperState::on_exit();
+        return;
+    }
+    on_exit();
+}
+
+void tao::HeatingSuperState::resume_level(StateValue level)
+{
+    if (level == tao::StateValue::STATE_HEATING)
+    {
+        restore_target();
+        // Whatever a substate left the heater in, HeaterOutputStage drops it if already on
+        m_toaster->heater_on();
+    }
+}
+
+float tao::HeatingSuperState::target_temperature()
+{
+    return DEMO_MAX_TEMP;
+}
+
+void tao::HeatingSuperState::restore_target()
+{
+    if (m_toaster->target_temperature() != target_temperature())
+    {
+        m_toaster->set_target_temperature(target_temperature());
+    }
+}
+
 /* *************************************************************************************************
 Implementations of tao::ToastingState
 ************************************************************************************************* */
 
 void tao::ToastingState::on_entry(void)
 {
-    // std::cout << "ToastingState::on_entry" << std::endl;
-    m_toaster->set_target_temperature(DEMO_MAX_TEMP);
-    m_toaster->heater_on(); /* TODO: This might be removed if Issue#2 is fixed */
-    m_toaster->arm_time_event(Toaster::ToastLevel::slightly_overcooked_toast);
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[ToastingState::on_entry]");
+    m_toaster->arm_time_event(ToasterCore::ToastLevel::slightly_overcooked_toast);
 }
 
 void tao::ToastingState::process_internal_event(InternalEvent event)
 {
-    // std::cout << "ToastingState::process_internal_event: " << stringify(event) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[ToastingState::process_internal_event] {}",
+                    stringify(event).c_str());
     switch (event)
     {
         case tao::InternalEvent::evt_alarm_timeout:
@@ -138,9 +186,7 @@ void tao::ToastingState::process_internal_event(InternalEvent event)
 
 void tao::ToastingState::on_exit(void)
 {
-    // std::cout << "ToastingState::on_exit" << std::endl;
-    m_toaster->set_target_temperature(DEMO_AMBIENT_TEMP);
-    m_toaster->heater_off(); /* TODO: This might be removed if Issue#2 is fixed */
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[ToastingState::on_exit]");
     m_toaster->disarm_time_event();
 }
 
@@ -148,25 +194,36 @@ void tao::ToastingState::on_exit(void)
 Implementations of tao::BakingState
 ************************************************************************************************* */
 
+TAO_COOKING_PROGRAM_BEGIN
+static tao::CookingProgram bake_program(ToasterCore &toaster, float temp,
+                                        std::chrono::milliseconds bake_time)
+{
+    co_await tao::heat_until(temp);
+    co_await tao::sleep_for(bake_time);
+    toaster.set_next_state(tao::StateValue::STATE_HEATING);
+}
+TAO_COOKING_PROGRAM_END
+
 void tao::BakingState::on_entry(void)
 {
-    // std::cout << "BakingState::on_entry" << std::endl;
-    m_toaster->set_target_temperature(50); /* TODO: Issue#4 */
-    m_toaster->heater_on();                /* TODO: This might be removed if Issue#2 is fixed */
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[BakingState::on_entry]");
+    /* TODO: Issue#4 */
+    if (!m_toaster->run_program(bake_program(*m_toaster, 50, std::chrono::milliseconds(10000))))
+    {
+        // Baking without its program would never end, the toaster goes back to heating instead
+        set_next_state(tao::StateValue::STATE_HEATING);
+    }
 }
 
 void tao::BakingState::process_internal_event(InternalEvent event)
 {
-    // std::cout << "BakingState::process_internal_event: " << stringify(event) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[BakingState::process_internal_event] {}",
+                    stringify(event).c_str());
     switch (event)
     {
         case tao::InternalEvent::evt_alarm_timeout:
             set_next_state(tao::StateValue::STATE_HEATING);
             break;
-        case tao::InternalEvent::evt_target_temp_reached:
-            /* TODO: Issue#3 */
-            m_toaster->arm_time_event(10000);
-            break;
         default:
             HeatingSuperState::unhandled_event(event);
             break;
@@ -175,9 +232,8 @@ void tao::BakingState::process_internal_event(InternalEvent event)
 
 void tao::BakingState::on_exit(void)
 {
-    // std::cout << "BakingState::on_exit" << std::endl;
-    m_toaster->set_target_temperature(DEMO_AMBIENT_TEMP);
-    m_toaster->heater_off(); /* TODO: This might be removed if Issue#2 is fixed */
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[BakingState::on_exit]");
+    m_toaster->cancel_program();
     m_toaster->disarm_time_event();
 }
 
@@ -186,19 +242,20 @@ Implementations of tao::DoorOpenState
 ************************************************************************************************* */
 void tao::DoorOpenState::on_entry()
 {
-    // std::cout << "DoorOpenState::on_entry" << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[DoorOpenState::on_entry]");
     m_toaster->internal_lamp_on();
 }
 
 void tao::DoorOpenState::process_internal_event(InternalEvent event)
 {
-    // std::cout << "DoorOpenState::process_internal_event: " << stringify(event) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[DoorOpenState::process_internal_event] {}",
+                    stringify(event).c_str());
     tao::GenericToasterState::unhandled_event(event);
 }
 
 void tao::DoorOpenState::on_exit()
 {
-    // std::cout << "DoorOpenState::on_exit" << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[DoorOpenState::on_exit]");
     m_toaster->internal_lamp_off();
 }
 
@@ -252,8 +309,8 @@ tao::InternalEvent tao::IncomingEventWrapper::map_temperature_sensor_event_to_in
 
 tao::InternalEvent tao::IncomingEventWrapper::map_incoming_event_to_internal_event()
 {
-    // std::cout << "tao::IncomingEventWrapper::map_incoming_event_to_internal_event()" <<
-    // std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject",
+                    "[IncomingEventWrapper::map_incoming_event_to_internal_event()]");
     switch (m_type)
     {
         case tao::IncomingEventWrapper::EventType::external_entity_event:
@@ -268,25 +325,63 @@ tao::InternalEvent tao::IncomingEventWrapper::map_incoming_event_to_internal_eve
             return boost::get<InternalEvent>(m_event);
             break;
         default:
-            // std::cout << "Discarding unknown external event for Toaster" << std::endl;
+            ASYNC_LOG_DEBUG("ToasterActiveObject", "Discarding unknown external event for Toaster");
             return tao::InternalEvent::unknown;
             break;
     }
 }
 
+std::uint16_t tao::IncomingEventWrapper::encode() const
+{
+    std::uint8_t code = 0;
+    switch (m_type)
+    {
+        case EventType::external_entity_event:
+            code = static_cast<std::uint8_t>(boost::get<ExternalEntityEvent>(m_event).which());
+            break;
+        case EventType::temperature_sensor_event:
+            code = static_cast<std::uint8_t>(boost::get<TempSensorEvent>(m_event).which());
+            break;
+        case EventType::internal_event:
+            code = static_cast<std::uint8_t>(boost::get<InternalEvent>(m_event));
+            break;
+        default:
+            return 0;
+    }
+    return static_cast<std::uint16_t>(static_cast<std::uint16_t>(m_type) << 8 | code);
+}
+
+tao::IncomingEventWrapper tao::IncomingEventWrapper::decode(std::uint16_t code)
+{
+    const std::uint8_t event = code & 0xff;
+    switch (static_cast<EventType>(code >> 8))
+    {
+        case EventType::external_entity_event:
+            return IncomingEventWrapper{
+                ExternalEntityEvent{static_cast<ExternalEntityEvtType>(event)}};
+        case EventType::temperature_sensor_event:
+            return IncomingEventWrapper{TempSensorEvent{static_cast<TempSensorEvtType>(event)}};
+        case EventType::internal_event:
+            return IncomingEventWrapper{static_cast<InternalEvent>(event)};
+        default:
+            return IncomingEventWrapper{InternalEvent::unknown};
+    }
+}
+
 /* *************************************************************************************************
-Implementations of Toaster
+Implementations of ToasterCore
 ************************************************************************************************* */
 
-void Toaster::set_next_state(tao::StateValue new_state)
+void ToasterCore::set_next_state(tao::StateValue new_state)
 {
-    // std::cout << "Toaster::set_next_state: " << stringify(new_state) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::set_next_state] {}",
+                    stringify(new_state).c_str());
     m_next_state = new_state;
 }
 
-void Toaster::set_state(tao::StateValue new_state)
+void ToasterCore::set_state(tao::StateValue new_state)
 {
-    // std::cout << "Toaster::set_state: " << stringify(new_state) << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::set_state] {}", stringify(new_state).c_str());
     switch (new_state)
     {
         case tao::StateValue::STATE_HEATING:
@@ -302,157 +397,109 @@ void Toaster::set_state(tao::StateValue new_state)
             m_state = std::make_shared<tao::DoorOpenState>(this);
             break;
         default:
-            // std::cout << "Attempt to set an invalid state" << std::endl;
-            break;
+            ASYNC_LOG_DEBUG("ToasterActiveObject", "Attempt to set an invalid state");
+            m_next_state = tao::StateValue::UNKNOWN;
+            return;
     }
+    m_metrics.state_entered(new_state, tao::ToasterMetrics::clock::now());
     m_next_state = tao::StateValue::UNKNOWN;
 }
 
-void Toaster::transition_state()
+void ToasterCore::transition_state()
 {
-    if (m_next_state != tao::StateValue::UNKNOWN)
+    // An entry action may refuse its state by asking for another one
+    while (m_next_state != tao::StateValue::UNKNOWN)
     {
-        /* TODO: Issue#2 */
-        m_state->on_exit();
+        const tao::TransitionPath &path = tao::transition_path(m_state->type(), m_next_state);
+        for (std::size_t i = 0; i < path.exit_count; i++)
+            m_state->exit_level(path.exits[i]);
+        if (path.exit_count > 0 && path.lca != tao::StateValue::UNKNOWN)
+        {
+            m_state->resume_level(path.lca);
+        }
         set_state(m_next_state);
-        m_state->on_entry();
+        for (std::size_t i = 0; i < path.entry_count; i++)
+            m_state->enter_level(path.entries[i]);
     }
 }
 
-void Toaster::state_machine_iteration()
-{
-    // std::cout << "Toaster::state_machine_iteration()" << std::endl;
-    tao::InternalEvent curr_evt = m_queue->wait_and_pop()->map_incoming_event_to_internal_event();
-    m_state->process_internal_event(curr_evt);
-    transition_state();
-}
-
-void Toaster::state_machine_iteration(tao::InternalEvent evt)
-{
-    m_state->process_internal_event(evt);
-    transition_state();
-}
-
-void Toaster::set_initial_state(tao::StateValue new_state)
+void ToasterCore::heater_on()
 {
-    // std::cout << "Toaster::set_initial_state: " << stringify(new_state) << std::endl;
-    set_state(new_state);
-    m_state->on_entry();
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::heater_on()]");
+    m_heater_output.request(Actuators::IHeater::Status::On);
 }
 
-void Toaster::run()
+void ToasterCore::heater_off()
 {
-    // std::cout << "Toaster::run()" << std::endl;
-    do
-    {
-        state_machine_iteration();
-    } while (m_running);
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::heater_off()]");
+    m_heater_output.request(Actuators::IHeater::Status::Off);
 }
 
-void Toaster::start()
+void ToasterCore::internal_lamp_on()
 {
-    // std::cout << "Toaster::start()" << std::endl;
-    m_running = true;
-    m_thread  = std::thread(&Toaster::run, this);
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::internal_lamp_on()]");
 }
 
-void Toaster::stop()
+void ToasterCore::internal_lamp_off()
 {
-    // std::cout << "Toaster::stop()" << std::endl;
-    if (!m_running)
-        return;
-
-    m_queue->put_prioritized(tao::IncomingEventWrapper(tao::InternalEvent::evt_stop));
-
-    if (m_thread.joinable())
-        m_thread.join();
-
-    m_queue->clear();
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::internal_lamp_off()]");
 }
 
-void Toaster::put_external_entity_event(const ExternalEntityEvent &evt)
+void ToasterCore::arm_time_event(long time)
 {
-    switch (evt.which())
+    if (m_timer->status() == DeadlineTimer::Status::running)
     {
-        case ExternalEntityEvtType::stop_request:
-        case ExternalEntityEvtType::toast_request:
-        case ExternalEntityEvtType::bake_request:
-        case ExternalEntityEvtType::opening_door:
-        case ExternalEntityEvtType::closing_door:
-            // m_queue->put_prioritized(tao::IncomingEventWrapper(evt));
-            // m_queue->put(tao::IncomingEventWrapper(evt));
-            generic_event_putter(evt);
-            break;
-        default:
-            // std::cout << "Warning: Received unhandled event from external entity: " <<
-            // stringify(evt) << std::endl;
-            break;
-    }
-}
-
-void Toaster::put_temp_sensor_event(const TempSensorEvent &evt)
-{
-    switch (evt.which())
-    {
-        case TempSensorEvtType::target_temp_reached:
-        case TempSensorEvtType::temp_below_target:
-        case TempSensorEvtType::temp_above_target:
-            generic_event_putter(evt);
-            break;
-        default:
-            // std::cout << "Warning: Received unhandled event from temperature sensor: " <<
-            // stringify(evt) << std::endl;
-            break;
+        return;
     }
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::arm_time_event(long time)]");
+    m_timer->start(time);
 }
 
-void Toaster::heater_on()
+void ToasterCore::arm_time_event(ToastLevel level)
 {
-    // std::cout << "Toaster::heater_on()" << std::endl;
-    m_heater->turn_on();
-}
-
-void Toaster::heater_off()
-{
-    // std::cout << "Toaster::heater_off()" << std::endl;
-    m_heater->turn_off();
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::arm_time_event(ToastLevel level)]");
+    long period = static_cast<long>(level) * 2000;  // Arbitrary hardcoded value
+    m_timer->start(period);
 }
 
-void Toaster::internal_lamp_on()
+void ToasterCore::disarm_time_event()
 {
-    // std::cout << "Toaster::internal_lamp_on()" << std::endl;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::disarm_time_event()]");
+    m_timer->stop();
 }
 
-void Toaster::internal_lamp_off()
+void ToasterCore::set_target_temperature(float temp)
 {
-    // std::cout << "Toaster::internal_lamp_off()" << std::endl;
+    m_target_temp.store(temp, std::memory_order_relaxed);
+    m_target_temp_pending = true;
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::set_target_temperature()] {}", temp);
 }
 
-void Toaster::arm_time_event(long time)
+bool ToasterCore::run_program(tao::CookingProgram program)
 {
-    if (m_timer.status() == DeadlineTimer::Status::running)
+    if (!program.valid())
     {
-        return;
+        ASYNC_LOG_ERROR("ToasterActiveObject",
+                        "[Toaster::run_program()] No room left for the program in the frame arena "
+                        "({} bytes in use)",
+                        m_frame_arena.in_use());
+        m_program.reset();
+        return false;
     }
-    // std::cout << "Toaster::arm_time_event(long time)" << std::endl;
-    m_timer.start(time);
+    // Runs the program up to its first co_await
+    m_program = std::move(program);
+    m_program.resume();
+    return true;
 }
 
-void Toaster::arm_time_event(ToastLevel level)
+void ToasterCore::cancel_program()
 {
-    // std::cout << "Toaster::arm_time_event(ToastLevel level)" << std::endl;
-    long period = static_cast<long>(level) * 2000;  // Arbitrary hardcoded value
-    m_timer.start(period);
+    m_program.reset();
 }
 
-void Toaster::disarm_time_event()
-{
-    // std::cout << "Toaster::disarm_time_event()" << std::endl;
-    m_timer.stop();
-}
+/* *************************************************************************************************
+Instantiation of the runtime-polymorphic Toaster, shared by every user of the library
+************************************************************************************************* */
 
-void Toaster::set_target_temperature(float temp)
-{
-    m_temp_sensor->set_target_temperature(temp);
-    // std::cout << "Toaster::set_target_temperature(float temp) - " << temp << std::endl;
-}
+template class BasicToaster<IThreadSafeQueue<tao::IncomingEventWrapper>, Actuators::IHeater,
+                            DemoObjects::TempSensorSpecializedCallback>;
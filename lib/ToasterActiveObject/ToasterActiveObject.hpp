@@ -1,25 +1,39 @@
 #ifndef __TOASTERACTIVEOBJECT__
 #define __TOASTERACTIVEOBJECT__
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ctime>
 #include <iostream>
 #include <map>
 #include <thread>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <type_traits>
+#include <utility>
 
 #include <boost/asio.hpp>
 #include <boost/variant.hpp>
 #include <boost/signals2.hpp>
 
 #include "Actuators.hpp"
+#include "AsyncLogger.hpp"
 #include "Sensors.hpp"
 #include "Events.hpp"
+#include "CookingProgram.hpp"
+#include "EventJournal.hpp"
+#include "ToasterMetrics.hpp"
+#include "ToasterSnapshot.hpp"
+#include "TraceRecorder.hpp"
 #include "ThreadSafeQueue.hpp"
 #include "BoostDeadlineTimer.hpp"
+#include "Seqlock.hpp"
+#include "ThermalModel.hpp"
 
 // Forward declaration
-class Toaster;
+class ToasterCore;
 
 // namespace toaster active object - tao
 namespace tao
@@ -69,6 +83,82 @@ static const std::vector<std::string> stringfier_StateValue{
 const std::string &stringify(StateValue state);
 std::ostream      &operator<<(std::ostream &os, const tao::StateValue &state);
 
+/* State hierarchy: toasting and baking are nested in heating, heating and door open are top
+level states (UNKNOWN stands for the top of the hierarchy) */
+constexpr StateValue parent_of(StateValue state)
+{
+    switch (state)
+    {
+        case StateValue::STATE_TOASTING:
+        case StateValue::STATE_BAKING:
+            return StateValue::STATE_HEATING;
+        default:
+            return StateValue::UNKNOWN;
+    }
+}
+
+constexpr std::size_t state_count     = 5;
+constexpr std::size_t max_state_depth = 2;
+
+/* Levels a transition leaves (innermost first) and enters (outermost first), and the innermost
+state it stays in (UNKNOWN when none) */
+struct TransitionPath
+{
+    StateValue                              lca{StateValue::UNKNOWN};
+    std::array<StateValue, max_state_depth> exits{};
+    std::size_t                             exit_count{0};
+    std::array<StateValue, max_state_depth> entries{};
+    std::size_t                             entry_count{0};
+};
+
+/* Only the states below the least common ancestor of source and target are exited and entered.
+A target nesting or nested in the source is a local transition (the outer state is neither exited
+nor re-entered), a transition to the source itself is external (the source is exited and
+re-entered). */
+constexpr TransitionPath make_transition_path(StateValue from, StateValue to)
+{
+    StateValue lca = parent_of(from);
+    if (from != to)
+    {
+        for (lca = from; lca != StateValue::UNKNOWN; lca = parent_of(lca))
+        {
+            bool is_ancestor_of_target = false;
+            for (StateValue s = to; s != StateValue::UNKNOWN; s = parent_of(s))
+                is_ancestor_of_target = is_ancestor_of_target || s == lca;
+            if (is_ancestor_of_target)
+            {
+                break;
+            }
+        }
+    }
+
+    TransitionPath path;
+    path.lca = lca;
+    for (StateValue s = from; s != lca; s = parent_of(s))
+        path.exits[path.exit_count++] = s;
+    for (StateValue s = to; s != lca; s = parent_of(s))
+        path.entry_count++;
+    std::size_t i = path.entry_count;
+    for (StateValue s = to; s != lca; s = parent_of(s))
+        path.entries[--i] = s;
+    return path;
+}
+
+inline constexpr auto transition_paths = []()
+{
+    std::array<std::array<TransitionPath, state_count>, state_count> paths{};
+    for (std::size_t from = 0; from < state_count; from++)
+        for (std::size_t to = 1; to < state_count; to++)
+            paths[from][to] =
+                make_transition_path(static_cast<StateValue>(from), static_cast<StateValue>(to));
+    return paths;
+}();
+
+constexpr const TransitionPath &transition_path(StateValue from, StateValue to)
+{
+    return transition_paths[static_cast<std::size_t>(from)][static_cast<std::size_t>(to)];
+}
+
 class IncomingEventWrapper
 {
    private:
@@ -100,6 +190,7 @@ class IncomingEventWrapper
     type_wrapper                                                        wrapper;
     boost::variant<ExternalEntityEvent, TempSensorEvent, InternalEvent> m_event;
     EventType                                                           m_type;
+    std::chrono::steady_clock::time_point                               m_created_at;
 
     tao::InternalEvent map_external_entity_event_to_internal_event(
         const ExternalEntityEvent &evt) const;
@@ -108,29 +199,60 @@ class IncomingEventWrapper
 
    public:
     IncomingEventWrapper(boost::variant<ExternalEntityEvent, TempSensorEvent, InternalEvent> e)
-        : m_event{e}, m_type{e.apply_visitor(wrapper)}
+        : m_event{e},
+          m_type{e.apply_visitor(wrapper)},
+          m_created_at{std::chrono::steady_clock::now()}
     {
     }
 
     tao::InternalEvent map_incoming_event_to_internal_event();
+    // Events of the toaster itself (timer...), as opposed to the ones of external entities
+    bool is_internal() const
+    {
+        return m_type != EventType::external_entity_event
+               && m_type != EventType::temperature_sensor_event;
+    }
+    /* Compact form for snapshots and journals: where the event comes from in the high byte, its
+    own code in the low one. 0 stands for an unknown event */
+    std::uint16_t               encode() const;
+    static IncomingEventWrapper decode(std::uint16_t code);
+    // When the event was wrapped, that is right before it was queued
+    std::chrono::steady_clock::time_point created_at() const
+    {
+        return m_created_at;
+    }
 };
 
 class GenericToasterState
 {
    public:
-    GenericToasterState(Toaster *tstr, StateValue state = StateValue::UNKNOWN)
+    GenericToasterState(ToasterCore *tstr, StateValue state = StateValue::UNKNOWN)
         : m_toaster{tstr}, m_state{state}
     {
     }
 
     virtual ~GenericToasterState() = default;
 
+    // Entry / exit actions of this state's own level of the hierarchy only
     virtual void on_entry()
     {
     }
     virtual void on_exit()
     {
     }
+    // Entry / exit actions of level, this state or one of the superstates it is nested in
+    virtual void enter_level(StateValue /*level*/)
+    {
+        on_entry();
+    }
+    virtual void exit_level(StateValue /*level*/)
+    {
+        on_exit();
+    }
+    // The transition stays in level, the states nested in it that it left were just exited
+    virtual void resume_level(StateValue /*level*/)
+    {
+    }
     virtual void       set_next_state(StateValue state);
     virtual void       unhandled_event(InternalEvent event);
     virtual void       process_internal_event(InternalEvent event) = 0;
@@ -140,7 +262,7 @@ class GenericToasterState
     }
 
    protected:
-    Toaster *m_toaster;
+    ToasterCore *m_toaster;
 
    private:
     StateValue m_state;
@@ -150,7 +272,7 @@ class HeatingSuperState : public GenericToasterState
 {
    public:
     virtual ~HeatingSuperState() = default;
-    HeatingSuperState(Toaster *tstr, StateValue state = StateValue::STATE_HEATING)
+    HeatingSuperState(ToasterCore *tstr, StateValue state = StateValue::STATE_HEATING)
         : GenericToasterState{tstr, state}
     {
     }
@@ -158,6 +280,14 @@ class HeatingSuperState : public GenericToasterState
     virtual void unhandled_event(InternalEvent event) override;
     virtual void process_internal_event(InternalEvent event) override;
     virtual void on_exit() override;
+    virtual void enter_level(StateValue level) override;
+    virtual void exit_level(StateValue level) override;
+    virtual void resume_level(StateValue level) override;
+
+    // What heating aims at, substates may aim elsewhere until they are exited
+    static float target_temperature();
+    // Back to target_temperature() after a substate changed it
+    void restore_target();
 };
 
 class ToastingState : public HeatingSuperState
@@ -166,7 +296,7 @@ class ToastingState : public HeatingSuperState
     virtual ~ToastingState()
     {
     }
-    ToastingState(Toaster *tstr) : HeatingSuperState{tstr, StateValue::STATE_TOASTING}
+    ToastingState(ToasterCore *tstr) : HeatingSuperState{tstr, StateValue::STATE_TOASTING}
     {
     }
     virtual void on_entry() override;
@@ -179,7 +309,7 @@ class BakingState : public HeatingSuperState
     virtual ~BakingState()
     {
     }
-    BakingState(Toaster *tstr) : HeatingSuperState{tstr, StateValue::STATE_BAKING}
+    BakingState(ToasterCore *tstr) : HeatingSuperState{tstr, StateValue::STATE_BAKING}
     {
     }
     virtual void on_entry() override;
@@ -190,7 +320,7 @@ class DoorOpenState : public GenericToasterState
 {
    public:
     virtual ~DoorOpenState() = default;
-    DoorOpenState(Toaster *tstr) : GenericToasterState{tstr, tao::StateValue::STATE_DOOR_OPEN}
+    DoorOpenState(ToasterCore *tstr) : GenericToasterState{tstr, tao::StateValue::STATE_DOOR_OPEN}
     {
     }
     virtual void on_entry() override;
@@ -204,14 +334,49 @@ namespace DemoObjects
 #define DEMO_AMBIENT_TEMP 25.0
 #define DEMO_MAX_TEMP 80.0
 #define DEMO_OBJECTS_TIMER_PERIOD 1000
-static float global_curr_temp_inside_toaster = DEMO_AMBIENT_TEMP;
+#define DEMO_SENSOR_HISTORY_SIZE 64
+
+struct ThermalSnapshot
+{
+    float                      temperature;
+    std::int64_t               timestamp_ns;
+    Actuators::IHeater::Status heater;
+};
+
+/* What happens inside one toaster: published by its HeaterDemo, read by its TempSensorDemo, so
+both must be given the same one. Both run on their own timer thread, readers always get a
+consistent snapshot without taking a lock */
+class ThermalState
+{
+   public:
+    ThermalState(float temperature = DEMO_AMBIENT_TEMP)
+        : m_snapshot{ThermalSnapshot{temperature, 0, Actuators::IHeater::Status::Off}}
+    {
+    }
+
+    void publish(float temperature, Actuators::IHeater::Status heater)
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        m_snapshot.store(ThermalSnapshot{
+            temperature, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(),
+            heater});
+    }
+
+    ThermalSnapshot read() const
+    {
+        return m_snapshot.load();
+    }
+
+   private:
+    SeqlockValue<ThermalSnapshot> m_snapshot;
+};
 
 class HeaterDemo : public Actuators::IHeater
 {
    public:
-    HeaterDemo(float &toaster_temp = global_curr_temp_inside_toaster)
-        : m_ref_curr_toaster_temp(toaster_temp),
-          m_temp(DEMO_AMBIENT_TEMP),
+    explicit HeaterDemo(std::shared_ptr<ThermalState> state)
+        : m_state(state),
+          m_temp(state->read().temperature),
           m_heater_timer{DEMO_OBJECTS_TIMER_PERIOD, boost::bind(&HeaterDemo::callback, this), true}
     {
         // Initializes common protected members from interface
@@ -220,6 +385,35 @@ class HeaterDemo : public Actuators::IHeater
         m_heater_timer.start();
     }
 
+    HeaterDemo(const boost::asio::any_io_executor &ex, std::shared_ptr<ThermalState> state)
+        : m_state(state),
+          m_temp(state->read().temperature),
+          m_heater_timer{ex, DEMO_OBJECTS_TIMER_PERIOD, boost::bind(&HeaterDemo::callback, this),
+                         true}
+    {
+        // Initializes common protected members from interface
+        m_status = Status::Off;
+
+        m_heater_timer.start();
+    }
+
+    /* Physical mode: the temperature follows a ThermalModel integrated at its own fixed step,
+    tick_period only sets how often the elapsed wall time is caught up with */
+    HeaterDemo(const ThermalSimulation::ThermalModel::Params &params,
+               std::shared_ptr<ThermalState>                  state,
+               long tick_period = DEMO_OBJECTS_TIMER_PERIOD)
+        : m_state(state),
+          m_temp(params.ambient_temp),
+          m_model{params},
+          m_last_tick{std::chrono::steady_clock::now()},
+          m_heater_timer{tick_period, boost::bind(&HeaterDemo::callback, this), true}
+    {
+        // Initializes common protected members from interface
+        m_status = Status::Off;
+
+        m_heater_timer.start();
+    }
+
     void turn_on() override
     {
         m_status = Status::On;
@@ -233,7 +427,15 @@ class HeaterDemo : public Actuators::IHeater
    private:
     void callback()
     {
-        if (m_status == Status::On && m_temp < DEMO_MAX_TEMP)
+        if (m_model)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            m_model->set_heater(m_status == Status::On);
+            m_model->advance_for(now - m_last_tick);
+            m_last_tick = now;
+            m_temp      = m_model->temperature();
+        }
+        else if (m_status == Status::On && m_temp < DEMO_MAX_TEMP)
         {
             m_temp++;
         }
@@ -242,13 +444,15 @@ class HeaterDemo : public Actuators::IHeater
             m_temp--;
         }
         // Toaster current internal temperature follows current heater temperature...
-        m_ref_curr_toaster_temp = m_temp;
+        m_state->publish(m_temp, m_status);
     }
 
    private:
-    float        &m_ref_curr_toaster_temp;
-    float         m_temp;
-    DeadlineTimer m_heater_timer;
+    std::shared_ptr<ThermalState>                 m_state;
+    float                                         m_temp;
+    std::optional<ThermalSimulation::ThermalModel> m_model;
+    std::chrono::steady_clock::time_point         m_last_tick;
+    DeadlineTimer                                 m_heater_timer;
 };
 using TempSensorSpecializedCallback =
     Sensors::ITempSensor<std::function<void(const TempSensorEvent &)>>;
@@ -257,8 +461,8 @@ class TempSensorDemo : public TempSensorSpecializedCallback
     using signal_t = boost::signals2::signal<void(const TempSensorEvent &evt)>;
 
    public:
-    TempSensorDemo(const float &toaster_temp = global_curr_temp_inside_toaster, float error = 2.0f)
-        : m_ref_curr_toaster_temp(toaster_temp),
+    explicit TempSensorDemo(std::shared_ptr<const ThermalState> state, float error = 2.0f)
+        : m_state(state),
           m_error(error),
           m_sensor_timer{DEMO_OBJECTS_TIMER_PERIOD, boost::bind(&TempSensorDemo::callback, this),
                          true}
@@ -271,6 +475,22 @@ class TempSensorDemo : public TempSensorSpecializedCallback
         m_sensor_timer.start();
     }
 
+    TempSensorDemo(const boost::asio::any_io_executor  &ex,
+                   std::shared_ptr<const ThermalState> state,
+                   float                               error = 2.0f)
+        : m_state(state),
+          m_error(error),
+          m_sensor_timer{ex, DEMO_OBJECTS_TIMER_PERIOD,
+                         boost::bind(&TempSensorDemo::callback, this), true}
+    {
+        // Initializes common protected members from interface
+        m_status      = Status::Off;
+        m_curr_temp   = DEMO_AMBIENT_TEMP;
+        m_target_temp = DEMO_AMBIENT_TEMP;
+
+        m_sensor_timer.start();
+    }
+
     // Overloading the initialize method
     void initialize(std::function<void(const TempSensorEvent &)> cb) override
     {
@@ -293,7 +513,11 @@ class TempSensorDemo : public TempSensorSpecializedCallback
 
     void set_target_temperature(float temp) override
     {
-        m_target_temp = temp;
+        // Called from the toaster thread: the sensor timer picks the change up on its next reading
+        if (m_target.exchange(temp, std::memory_order_relaxed) != temp)
+        {
+            m_target_changed.store(true, std::memory_order_release);
+        }
     }
 
     Status get_status() const override
@@ -301,6 +525,11 @@ class TempSensorDemo : public TempSensorSpecializedCallback
         return m_status;
     }
 
+    const Sensors::TempHistory *history() const override
+    {
+        return &m_history;
+    }
+
    private:
     template <typename F>
     void register_callback(F &&handler)
@@ -310,19 +539,20 @@ class TempSensorDemo : public TempSensorSpecializedCallback
 
     void callback()
     {
-        m_curr_temp = m_ref_curr_toaster_temp;
+        m_curr_temp = m_state->read().temperature;
+        m_history.push(m_curr_temp);
 
-        if ((m_curr_temp > m_target_temp - m_error) && (m_curr_temp < m_target_temp + m_error))
-        {
-            publish_event(TempSensorEvent{TempSensorEvtType::target_temp_reached});
-        }
-        else if (m_curr_temp > m_target_temp - m_error)
+        if (m_target_changed.exchange(false, std::memory_order_acquire))
         {
-            publish_event(TempSensorEvent{TempSensorEvtType::temp_above_target});
+            // A new target makes the last published classification meaningless
+            m_classifier.invalidate();
         }
-        else if (m_curr_temp < m_target_temp + m_error)
+        auto evt = m_classifier.update(m_curr_temp, m_target.load(std::memory_order_relaxed),
+                                       m_error, m_publish_policy,
+                                       Sensors::TempClassifier::clock::now());
+        if (evt)
         {
-            publish_event(TempSensorEvent{TempSensorEvtType::temp_below_target});
+            publish_event(TempSensorEvent{*evt});
         }
     }
 
@@ -333,15 +563,21 @@ class TempSensorDemo : public TempSensorSpecializedCallback
     }
 
    private:
-    const float  &m_ref_curr_toaster_temp;
-    signal_t      m_signal;
-    float         m_error;
-    DeadlineTimer m_sensor_timer;
+    std::shared_ptr<const ThermalState> m_state;
+    signal_t                            m_signal;
+    float                               m_error;
+    std::atomic<float>                  m_target{DEMO_AMBIENT_TEMP};
+    std::atomic<bool>                   m_target_changed{false};
+    Sensors::TempClassifier             m_classifier;  // Only touched by the sensor timer
+    Sensors::TempHistory                m_history{DEMO_SENSOR_HISTORY_SIZE};
+    DeadlineTimer                       m_sensor_timer;
 };
 }  // namespace DemoObjects
 
-/* TODO: Issue#7 - Implement unit tests for Toaster*/
-class Toaster
+/* What the states and cooking programs of a toaster work with, whatever its queue, heater and
+sensor are. Heater commands and target temperatures are only recorded here, BasicToaster applies
+them to its heater and sensor at the end of every run-to-completion step */
+class ToasterCore
 {
    public:
     enum class DoorStatus
@@ -360,27 +596,183 @@ class Toaster
         charcoal,
     };
 
-    Toaster(std::shared_ptr<Actuators::IHeater>                         htr,
-            std::shared_ptr<DemoObjects::TempSensorSpecializedCallback> ssr)
-        : m_queue{std::make_shared<SimplestThreadSafeQueue<tao::IncomingEventWrapper>>()},
-          m_heater{htr},
-          m_temp_sensor{ssr},
-          m_timer{1000, boost::bind(&Toaster::timer_callback, this), false}
+    void set_next_state(tao::StateValue new_state);
+    void set_state(tao::StateValue new_state);
+    void transition_state();
+
+    /* Every event put from now on (timer expirations included) is also appended to journal, with
+    id as its source. Meant to be set before start(), nullptr turns journaling off */
+    void set_journal(std::shared_ptr<EventJournal> journal, std::uint32_t id = 0)
+    {
+        m_journal    = std::move(journal);
+        m_journal_id = id;
+    }
+
+    // Applied once, at the end of the current run-to-completion step
+    void heater_on();
+    void heater_off();
+    const Actuators::HeaterOutputStage &heater_output() const
+    {
+        return m_heater_output;
+    }
+    void internal_lamp_on();
+    void internal_lamp_off();
+    void arm_time_event(long time);
+    void arm_time_event(ToastLevel level);
+    void disarm_time_event();
+    // Applied to the sensor at the end of the current run-to-completion step, like heater commands
+    void  set_target_temperature(float temp);
+    float target_temperature() const
+    {
+        return m_target_temp.load(std::memory_order_relaxed);
+    }
+    // False, and an error logged, for a program that couldn't be allocated (FrameArena full)
+    bool run_program(tao::CookingProgram program);
+    void cancel_program();
+
+    /* Extrapolated from the sensor history, empty when unknown or not moving towards the target.
+    For the states and cooking programs as well as for other threads */
+    std::optional<std::chrono::milliseconds> time_to_target_temperature() const
+    {
+        if (m_temp_history == nullptr)
+        {
+            return std::nullopt;
+        }
+        return m_temp_history->time_to_reach(m_target_temp.load(std::memory_order_relaxed));
+    }
+
+    // Can be read from any thread without disturbing the toaster
+    DeadlineTimer::Lateness timer_lateness() const
+    {
+        return m_timer->lateness();
+    }
+
+    std::atomic<bool>                         m_running{false};
+    std::shared_ptr<tao::GenericToasterState> m_state;
+    tao::StateValue                           m_next_state{tao::StateValue::UNKNOWN};
+    DoorStatus                                m_door_status{DoorStatus::closed};
+    tao::FrameArena                           m_frame_arena;
+    tao::CookingProgram                       m_program;
+    tao::TraceRecorder                        m_trace;
+    tao::ToasterMetrics                       m_metrics;
+
+   protected:
+    explicit ToasterCore(std::function<void(void)> on_alarm)
+    {
+        m_timer.emplace(1000, std::move(on_alarm), false);
+    }
+    ToasterCore(const boost::asio::any_io_executor &ex, std::function<void(void)> on_alarm)
+        : m_executor{ex}
+    {
+        m_timer.emplace(ex, 1000, std::move(on_alarm), false);
+    }
+    ~ToasterCore() = default;
+
+    /* Executor mode: posts handler on m_executor, it is skipped once release_lifetime() was
+    called. Handlers already queued on the executor may still be run after the toaster is gone */
+    template <class Handler>
+    void post_guarded(Handler &&handler)
+    {
+        boost::asio::post(m_executor,
+                          [alive = std::weak_ptr<void>(m_lifetime),
+                           handler = std::forward<Handler>(handler)]() mutable
+                          {
+                              if (const auto guard = alive.lock())
+                              {
+                                  handler();
+                              }
+                          });
+    }
+    /* Skips every handler post_guarded() still has on the executor, and waits for the one running
+    on another thread (if any) to be done. Must not be called from one of those handlers */
+    void release_lifetime()
+    {
+        std::weak_ptr<void> watch = m_lifetime;
+        m_lifetime.reset();
+        while (!watch.expired())
+            std::this_thread::yield();
+    }
+
+    // waiting: events the queue (or the executor) still holds, that wrapped goes behind or ahead of
+    void journal(const tao::IncomingEventWrapper &wrapped, std::uint16_t flags, std::size_t waiting)
     {
+        if (m_journal)
+        {
+            m_journal->append(m_journal_id, wrapped.encode(),
+                              JournalRecord::make_flags(flags, waiting));
+        }
+    }
+
+    boost::asio::any_io_executor  m_executor;
+    Actuators::HeaterOutputStage  m_heater_output;
+    std::atomic<float>            m_target_temp{0.0f};  // Also read by other threads
+    bool                          m_target_temp_pending{false};
+    const Sensors::TempHistory   *m_temp_history{nullptr};  // Owned by the derived toaster's sensor
+    std::shared_ptr<EventJournal> m_journal;
+    std::uint32_t                 m_journal_id{0};
+    std::shared_ptr<void>         m_lifetime{std::make_shared<char>()};
+    // Reset first thing by ~BasicToaster(): its callback reaches members of the derived toaster
+    std::optional<DeadlineTimer> m_timer;
+};
+
+/* A toaster bound at compile time to its queue, heater and sensor types, so that the calls of the
+event path can be inlined whenever those are concrete (final) classes. Toaster, below, binds the
+interfaces and keeps any implementation pluggable at run time. Queue may be an abstract
+IThreadSafeQueue, a SimplestThreadSafeQueue is created for it then. */
+template <class Queue, class Heater, class Sensor>
+class BasicToaster : public ToasterCore
+{
+   public:
+    using queue_type  = Queue;
+    using heater_type = Heater;
+    using sensor_type = Sensor;
+
+    BasicToaster(std::shared_ptr<Heater> htr, std::shared_ptr<Sensor> ssr)
+        : ToasterCore{[this]() { timer_callback(); }},
+          m_queue{make_queue()},
+          m_heater{std::move(htr)},
+          m_temp_sensor{std::move(ssr)}
+    {
+        m_temp_history = m_temp_sensor->history();
+        set_initial_state(tao::StateValue::STATE_HEATING);
+        m_temp_sensor->initialize(
+            boost::bind(&BasicToaster::put_temp_sensor_event, this, boost::placeholders::_1));
+    }
+
+    /* Executor mode: no thread and no queue of its own (m_queue stays empty). Incoming events and
+    timer expirations are posted as handlers on ex, which must serialize them (a strand, or an
+    io_context run by a single thread). Many toasters may share the same io_context. Handlers
+    still posted when the toaster is destroyed are skipped; it must not be destroyed from one of
+    its own handlers though. */
+    BasicToaster(const boost::asio::any_io_executor &ex, std::shared_ptr<Heater> htr,
+                 std::shared_ptr<Sensor> ssr)
+        : ToasterCore{ex, [this]() { timer_callback(); }},
+          m_heater{std::move(htr)},
+          m_temp_sensor{std::move(ssr)}
+    {
+        m_temp_history = m_temp_sensor->history();
         set_initial_state(tao::StateValue::STATE_HEATING);
         m_temp_sensor->initialize(
-            boost::bind(&Toaster::put_temp_sensor_event, this, boost::placeholders::_1));
+            boost::bind(&BasicToaster::put_temp_sensor_event, this, boost::placeholders::_1));
+    }
+
+    BasicToaster(boost::asio::io_context &ioc, std::shared_ptr<Heater> htr,
+                 std::shared_ptr<Sensor> ssr)
+        : BasicToaster(boost::asio::make_strand(ioc), std::move(htr), std::move(ssr))
+    {
     }
 
-    ~Toaster()
+    ~BasicToaster()
     {
         stop();
-        m_queue->clear();
+        release_lifetime();
+        m_timer.reset();
+        if (m_queue)
+        {
+            m_queue->clear();
+        }
     }
 
-    void set_next_state(tao::StateValue new_state);
-    void set_state(tao::StateValue new_state);
-    void transition_state();
     void state_machine_iteration();
     void state_machine_iteration(tao::InternalEvent evt);
     void set_initial_state(tao::StateValue new_state);
@@ -395,36 +787,387 @@ class Toaster
     template <class T>
     void generic_event_putter(const T &event)
     {
-        m_queue->put(tao::IncomingEventWrapper{event});
+        tao::IncomingEventWrapper wrapped{event};
+        journal(wrapped, 0, queue_depth());
+        if (m_executor)
+        {
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            post_guarded(
+                [this, wrapped]() mutable
+                {
+                    m_pending.fetch_sub(1, std::memory_order_relaxed);
+                    if (m_running)
+                    {
+                        dispatch(wrapped);
+                    }
+                });
+            return;
+        }
+        m_queue->put(std::move(wrapped));
     }
 
-    void heater_on();
-    void heater_off();
-    void internal_lamp_on();
-    void internal_lamp_off();
-    void arm_time_event(long time);
-    void arm_time_event(ToastLevel level);
-    void disarm_time_event();
-    void set_target_temperature(float temp);
+    /* Events that went through put_external_entity_event() / put_temp_sensor_event() checks
+    already, queued in one go. Leaves events empty */
+    void put_batch(std::vector<tao::IncomingEventWrapper> &events);
 
-    bool                                      m_running{false};
-    std::shared_ptr<tao::GenericToasterState> m_state;
-    tao::StateValue                           m_next_state{tao::StateValue::UNKNOWN};
-    DoorStatus                                m_door_status;
-    std::shared_ptr<IThreadSafeQueue<tao::IncomingEventWrapper>> m_queue;
+    // Events put but not dispatched yet, either in m_queue or posted on the executor
+    std::size_t queue_depth() const
+    {
+        return m_queue ? m_queue->size() : m_pending.load(std::memory_order_relaxed);
+    }
+
+    // CPU time used by the toaster thread, empty in executor mode or when it isn't running
+    std::optional<std::chrono::nanoseconds> thread_cpu_time() const;
+
+    /* Warm restart. Both are meant for a toaster that isn't running (or its own thread): snapshot()
+    captures the state, door, target temperature, time left on the timer and the events still
+    queued, restore() brings a toaster back to exactly that, entry actions of the restored states
+    included. An empty snapshot (UNKNOWN state) is not restored and restore() returns false.
+    In executor mode events posted but not dispatched can't be read back, snapshot() only counts
+    them in queued_dropped, and restore() posts the queued events of the snapshot on the executor */
+    tao::ToasterSnapshot snapshot() const;
+    bool                 restore(const tao::ToasterSnapshot &snapshot);
+
+    std::shared_ptr<Queue> m_queue;  // Empty in executor mode
 
    private:
+    static std::shared_ptr<Queue> make_queue()
+    {
+        if constexpr (std::is_abstract_v<Queue>)
+        {
+            return std::make_shared<SimplestThreadSafeQueue<tao::IncomingEventWrapper>>();
+        }
+        else
+        {
+            return std::make_shared<Queue>();
+        }
+    }
+
+    // Executor mode: posts events to be dispatched in order, counted by queue_depth() meanwhile
+    void post_batch(std::vector<tao::IncomingEventWrapper> batch);
+    // One step for an event that went through the queue (or the executor)
+    void dispatch(tao::IncomingEventWrapper &wrapped);
+    tao::TraceRecorder::clock::time_point step(tao::InternalEvent evt);
+    // Heater command and target temperature recorded during the step
+    void flush_outputs();
+
     void timer_callback()
     {
-        m_queue->put_prioritized(tao::IncomingEventWrapper(tao::InternalEvent::evt_alarm_timeout));
+        tao::IncomingEventWrapper alarm{tao::InternalEvent::evt_alarm_timeout};
+        journal(alarm, JournalRecord::prioritized, queue_depth());
+        if (m_executor)
+        {
+            // Already running on m_executor, so the alarm is dispatched right here
+            if (m_running)
+            {
+                dispatch(alarm);
+            }
+            return;
+        }
+        m_queue->put_prioritized(std::move(alarm));
     }
 
-   private:
-    std::shared_ptr<Actuators::IHeater>                         m_heater;
-    std::shared_ptr<DemoObjects::TempSensorSpecializedCallback> m_temp_sensor;
-    float                                                       m_target_temp;
-    std::thread                                                 m_thread;
-    DeadlineTimer                                               m_timer;
+    std::shared_ptr<Heater>  m_heater;
+    std::shared_ptr<Sensor>  m_temp_sensor;
+    std::atomic<std::size_t> m_pending{0};  // Executor mode: events posted, not dispatched yet
+    std::thread              m_thread;
+    clockid_t                m_thread_cpu_clock;
+    std::atomic<bool>        m_thread_cpu_clock_valid{false};
 };
 
-#endif
\ No newline at end of file
+/* *************************************************************************************************
+Implementations of BasicToaster
+************************************************************************************************* */
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::state_machine_iteration()
+{
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::state_machine_iteration()]");
+    dispatch(*m_queue->wait_and_pop());
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::state_machine_iteration(tao::InternalEvent evt)
+{
+    step(evt);
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::dispatch(tao::IncomingEventWrapper &wrapped)
+{
+    const auto handled = step(wrapped.map_incoming_event_to_internal_event());
+    m_metrics.event_dispatched(handled - wrapped.created_at());
+}
+
+template <class Queue, class Heater, class Sensor>
+tao::TraceRecorder::clock::time_point BasicToaster<Queue, Heater, Sensor>::step(
+    tao::InternalEvent evt)
+{
+    const auto            started = tao::TraceRecorder::clock::now();
+    const tao::StateValue before  = m_state->type();
+
+    // A cooking program waiting for this very event consumes it before the state does
+    if (m_program.awaits(evt))
+    {
+        m_program.resume();
+    }
+    else
+    {
+        m_state->process_internal_event(evt);
+    }
+    transition_state();
+    const auto handled = tao::TraceRecorder::clock::now();
+    flush_outputs();
+
+    m_metrics.event_handled(evt, handled - started);
+    m_trace.record(evt, before, m_state->type(), started, handled, queue_depth());
+    return handled;
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::flush_outputs()
+{
+    m_heater_output.flush(*m_heater);
+    if (m_target_temp_pending)
+    {
+        m_temp_sensor->set_target_temperature(m_target_temp.load(std::memory_order_relaxed));
+        m_target_temp_pending = false;
+    }
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::set_initial_state(tao::StateValue new_state)
+{
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::set_initial_state] {}",
+                    stringify(new_state).c_str());
+    const tao::TransitionPath &path = tao::transition_path(tao::StateValue::UNKNOWN, new_state);
+    set_state(new_state);
+    for (std::size_t i = 0; i < path.entry_count; i++)
+        m_state->enter_level(path.entries[i]);
+    flush_outputs();
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::run()
+{
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::run()]");
+    if (m_executor)
+    {
+        ASYNC_LOG_ERROR("ToasterActiveObject", "[Toaster::run()] Executor mode, nothing to run");
+        return;
+    }
+    do
+    {
+        state_machine_iteration();
+    } while (m_running);
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::start()
+{
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::start()]");
+    m_running = true;
+    if (m_executor)
+    {
+        return;
+    }
+    m_thread = std::thread(&BasicToaster::run, this);
+    if (pthread_getcpuclockid(m_thread.native_handle(), &m_thread_cpu_clock) == 0)
+    {
+        m_thread_cpu_clock_valid.store(true, std::memory_order_release);
+    }
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::stop()
+{
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::stop()]");
+    if (!m_running)
+    {
+        // An evt_stop may have ended the thread already, it still has to be joined
+        m_thread_cpu_clock_valid.store(false, std::memory_order_release);
+        if (m_thread.joinable())
+            m_thread.join();
+        return;
+    }
+
+    if (m_executor)
+    {
+        // Handlers still queued on the executor (timer included) see m_running and bail out
+        m_running = false;
+        return;
+    }
+
+    m_queue->put_prioritized(tao::IncomingEventWrapper(tao::InternalEvent::evt_stop));
+
+    m_thread_cpu_clock_valid.store(false, std::memory_order_release);
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::put_external_entity_event(const ExternalEntityEvent &evt)
+{
+    switch (evt.which())
+    {
+        case ExternalEntityEvtType::stop_request:
+        case ExternalEntityEvtType::toast_request:
+        case ExternalEntityEvtType::bake_request:
+        case ExternalEntityEvtType::opening_door:
+        case ExternalEntityEvtType::closing_door:
+            generic_event_putter(evt);
+            break;
+        default:
+            ASYNC_LOG_WARN("ToasterActiveObject",
+                           "[put_external_entity_event()] Received unhandled event: {}",
+                           stringify(evt).c_str());
+            break;
+    }
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::put_temp_sensor_event(const TempSensorEvent &evt)
+{
+    switch (evt.which())
+    {
+        case TempSensorEvtType::target_temp_reached:
+        case TempSensorEvtType::temp_below_target:
+        case TempSensorEvtType::temp_above_target:
+            generic_event_putter(evt);
+            break;
+        default:
+            ASYNC_LOG_WARN("ToasterActiveObject",
+                           "[put_temp_sensor_event()] Received unhandled event: {}",
+                           stringify(evt).c_str());
+            break;
+    }
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::put_batch(std::vector<tao::IncomingEventWrapper> &events)
+{
+    // The events of the batch are waiting for one another too
+    const std::size_t waiting = queue_depth();
+    for (std::size_t i = 0; i < events.size(); i++)
+        journal(events[i], 0, waiting + i);
+    if (m_executor)
+    {
+        post_batch(std::move(events));
+        events.clear();
+        return;
+    }
+    m_queue->put_batch(events);
+}
+
+template <class Queue, class Heater, class Sensor>
+void BasicToaster<Queue, Heater, Sensor>::post_batch(std::vector<tao::IncomingEventWrapper> batch)
+{
+    m_pending.fetch_add(batch.size(), std::memory_order_relaxed);
+    post_guarded(
+        [this, batch = std::move(batch)]() mutable
+        {
+            for (auto &event : batch)
+            {
+                m_pending.fetch_sub(1, std::memory_order_relaxed);
+                if (m_running)
+                {
+                    dispatch(event);
+                }
+            }
+        });
+}
+
+template <class Queue, class Heater, class Sensor>
+std::optional<std::chrono::nanoseconds> BasicToaster<Queue, Heater, Sensor>::thread_cpu_time() const
+{
+    timespec ts;
+    if (!m_thread_cpu_clock_valid.load(std::memory_order_acquire)
+        || clock_gettime(m_thread_cpu_clock, &ts) != 0)
+    {
+        return std::nullopt;
+    }
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+template <class Queue, class Heater, class Sensor>
+tao::ToasterSnapshot BasicToaster<Queue, Heater, Sensor>::snapshot() const
+{
+    tao::ToasterSnapshot snapshot{};
+    snapshot.state       = static_cast<std::uint8_t>(m_state->type());
+    snapshot.door_open   = m_door_status == DoorStatus::opened;
+    snapshot.target_temp = m_target_temp.load(std::memory_order_relaxed);
+    const auto remaining = m_timer->remaining();
+    snapshot.timer_remaining_ms = remaining ? static_cast<std::int32_t>(remaining->count()) : -1;
+
+    if (!m_queue)
+    {
+        // Posted on the executor, where they can't be read back: only counted
+        snapshot.queued_dropped = static_cast<std::uint32_t>(queue_depth());
+        return snapshot;
+    }
+    for (const auto &event : m_queue->contents())
+    {
+        if (snapshot.queued_count == tao::ToasterSnapshot::max_queued)
+        {
+            snapshot.queued_dropped++;
+            continue;
+        }
+        snapshot.queued[snapshot.queued_count++] = event.encode();
+    }
+    return snapshot;
+}
+
+template <class Queue, class Heater, class Sensor>
+bool BasicToaster<Queue, Heater, Sensor>::restore(const tao::ToasterSnapshot &snapshot)
+{
+    const auto state = static_cast<tao::StateValue>(snapshot.state);
+    if (state == tao::StateValue::UNKNOWN || snapshot.state >= tao::state_count)
+    {
+        return false;
+    }
+    ASYNC_LOG_DEBUG("ToasterActiveObject", "[Toaster::restore] {}", stringify(state).c_str());
+
+    // Leaves the whole hierarchy, then enters it again the way set_initial_state() does
+    const tao::TransitionPath path =
+        tao::make_transition_path(m_state->type(), tao::StateValue::UNKNOWN);
+    for (std::size_t i = 0; i < path.exit_count; i++)
+        m_state->exit_level(path.exits[i]);
+    set_initial_state(state);
+
+    // What the entry actions just set up is overridden by what the snapshot recorded
+    m_door_status = snapshot.door_open ? DoorStatus::opened : DoorStatus::closed;
+    set_target_temperature(snapshot.target_temp);
+    disarm_time_event();
+    if (snapshot.timer_remaining_ms >= 0)
+    {
+        arm_time_event(static_cast<long>(snapshot.timer_remaining_ms));
+    }
+    flush_outputs();
+
+    const std::size_t count = std::min<std::size_t>(snapshot.queued_count, snapshot.queued.size());
+    if (m_executor)
+    {
+        // Dispatched by the executor once it gets to them, after what it already had
+        std::vector<tao::IncomingEventWrapper> batch;
+        batch.reserve(count);
+        for (std::size_t i = 0; i < count; i++)
+            batch.push_back(tao::IncomingEventWrapper::decode(snapshot.queued[i]));
+        if (!batch.empty())
+        {
+            post_batch(std::move(batch));
+        }
+        return true;
+    }
+    m_queue->clear();
+    for (std::size_t i = 0; i < count; i++)
+        m_queue->put(tao::IncomingEventWrapper::decode(snapshot.queued[i]));
+    return true;
+}
+
+// Runtime-polymorphic toaster: any queue, heater and sensor implementation, chosen at run time
+using Toaster = BasicToaster<IThreadSafeQueue<tao::IncomingEventWrapper>, Actuators::IHeater,
+                             DemoObjects::TempSensorSpecializedCallback>;
+extern template class BasicToaster<IThreadSafeQueue<tao::IncomingEventWrapper>, Actuators::IHeater,
+                                   DemoObjects::TempSensorSpecializedCallback>;
+
+#endif
@@ -0,0 +1,52 @@
+#include "ToasterActiveObject.hpp"
+
+static_assert(static_cast<std::size_t>(tao::StateValue::STATE_DOOR_OPEN)
+                  < tao::MetricsSnapshot::max_states,
+              "Not enough room for every state in tao::MetricsSnapshot");
+static_assert(static_cast<std::size_t>(tao::InternalEvent::evt_max)
+                  <= tao::MetricsSnapshot::max_events,
+              "Not enough room for every event in tao::MetricsSnapshot");
+
+std::uint64_t tao::LatencyHistogram::percentile(double q) const
+{
+    std::uint64_t total = 0;
+    for (auto count : counts)
+        total += count;
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    const auto    rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < bucket_count; bucket++)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+        {
+            return bucket + 1 < bucket_count ? lower_bound(bucket + 1) - 1 : UINT32_MAX;
+        }
+    }
+    return UINT32_MAX;
+}
+
+tao::MetricsSnapshot tao::ToasterMetrics::snapshot(clock::time_point now) const
+{
+    MetricsSnapshot result;
+    m_states_lock.read(
+        [&]()
+        {
+            result.states = m_states;
+            if (m_current_state < MetricsSnapshot::max_states && now > m_entered_at)
+            {
+                result.states[m_current_state].dwell_ns +=
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_entered_at)
+                        .count();
+            }
+        });
+    for (std::size_t i = 0; i < MetricsSnapshot::max_events; i++)
+        m_events[i].lock.read([&]() { result.events[i] = m_events[i].metrics; });
+    m_dispatch.lock.read([&]() { result.dispatch = m_dispatch.metrics; });
+    result.unhandled_events = m_unhandled.load(std::memory_order_relaxed);
+    return result;
+}
@@ -0,0 +1,179 @@
+#ifndef __TOASTERMETRICS__
+#define __TOASTERMETRICS__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "Seqlock.hpp"
+
+// namespace toaster active object - tao
+namespace tao
+{
+enum class InternalEvent;
+enum class StateValue;
+
+/* Log-linear latency histogram: every power of two range of nanoseconds is split in 8 equal
+buckets, so any value is known within 12.5% whatever its magnitude. Covers up to ~4.3 s */
+struct LatencyHistogram
+{
+    static constexpr unsigned    sub_bucket_bits = 3;
+    static constexpr std::size_t sub_buckets     = std::size_t{1} << sub_bucket_bits;
+    static constexpr std::size_t bucket_count    = (32 - sub_bucket_bits + 1) * sub_buckets;
+
+    static constexpr std::size_t bucket_of(std::uint32_t ns)
+    {
+        if (ns < sub_buckets)
+        {
+            return ns;
+        }
+        const unsigned exponent = 31 - static_cast<unsigned>(__builtin_clz(ns));
+        const unsigned sub      = (ns >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+        return (exponent - sub_bucket_bits + 1) * sub_buckets + sub;
+    }
+    // Smallest value landing in bucket
+    static constexpr std::uint64_t lower_bound(std::size_t bucket)
+    {
+        if (bucket < sub_buckets)
+        {
+            return bucket;
+        }
+        const unsigned exponent = static_cast<unsigned>(bucket / sub_buckets) + sub_bucket_bits - 1;
+        return (sub_buckets + bucket % sub_buckets) << (exponent - sub_bucket_bits);
+    }
+
+    void add(std::uint32_t ns)
+    {
+        counts[bucket_of(ns)]++;
+    }
+    // Upper bound of the bucket holding the q-quantile (0 <= q <= 1), 0 when empty
+    std::uint64_t percentile(double q) const;
+
+    std::array<std::uint64_t, bucket_count> counts{};
+};
+
+struct StateMetrics
+{
+    std::uint64_t entries{0};
+    std::uint64_t dwell_ns{0};  // Total time spent in the state, current stay included
+};
+
+struct EventMetrics
+{
+    std::uint64_t    count{0};
+    std::uint64_t    total_ns{0};  // process_internal_event + transition_state
+    LatencyHistogram latency;
+};
+
+struct MetricsSnapshot
+{
+    static constexpr std::size_t max_states = 8;
+    static constexpr std::size_t max_events = 16;
+
+    std::array<StateMetrics, max_states> states{};
+    std::array<EventMetrics, max_events> events{};
+    EventMetrics                         dispatch;  // Put (or expired) to transitioned, alarms too
+    std::uint64_t                        unhandled_events{0};  // No state had a use for them
+
+    const StateMetrics &state(StateValue value) const
+    {
+        return states[static_cast<std::size_t>(value)];
+    }
+    const EventMetrics &event(InternalEvent value) const
+    {
+        return events[static_cast<std::size_t>(value)];
+    }
+};
+
+/* Metrics of one Toaster. Written without locks by the toaster's own thread only, read from any
+monitoring thread: each block sits behind its own seqlock, so a reader gets consistent counters
+per state and per event and never delays the toaster. */
+class ToasterMetrics
+{
+   public:
+    using clock = std::chrono::steady_clock;
+
+    void state_entered(StateValue state, clock::time_point now)
+    {
+        m_states_lock.write(
+            [&]()
+            {
+                close_dwell(now);
+                m_current_state = static_cast<std::size_t>(state);
+                m_entered_at    = now;
+                m_states[m_current_state].entries++;
+            });
+    }
+
+    void event_handled(InternalEvent event, clock::duration latency)
+    {
+        add(m_events[static_cast<std::size_t>(event)], latency);
+    }
+
+    // Time an event spent between being put in the queue and the end of its transition
+    void event_dispatched(clock::duration latency)
+    {
+        add(m_dispatch, latency);
+    }
+
+    void event_unhandled()
+    {
+        m_unhandled.store(m_unhandled.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    }
+
+    MetricsSnapshot snapshot(clock::time_point now = clock::now()) const;
+
+    // Events put or alarms handled so far, much cheaper than a whole snapshot()
+    std::uint64_t dispatched() const
+    {
+        std::uint64_t count = 0;
+        m_dispatch.lock.read([&]() { count = m_dispatch.metrics.count; });
+        return count;
+    }
+
+   private:
+    void close_dwell(clock::time_point now)
+    {
+        if (m_current_state < MetricsSnapshot::max_states && now > m_entered_at)
+        {
+            m_states[m_current_state].dwell_ns +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_entered_at).count();
+        }
+    }
+
+    struct Event
+    {
+        Seqlock      lock;
+        EventMetrics metrics;
+    };
+
+    static void add(Event &slot, clock::duration latency)
+    {
+        const auto ns      = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+        const auto clamped = static_cast<std::uint32_t>(
+            std::min<std::int64_t>(std::max<std::int64_t>(ns, 0), UINT32_MAX));
+        slot.lock.write(
+            [&]()
+            {
+                slot.metrics.count++;
+                slot.metrics.total_ns += clamped;
+                slot.metrics.latency.add(clamped);
+            });
+    }
+
+    Seqlock                                               m_states_lock;
+    std::array<StateMetrics, MetricsSnapshot::max_states> m_states{};
+    std::size_t                                           m_current_state{SIZE_MAX};
+    clock::time_point                                     m_entered_at{};
+    std::array<Event, MetricsSnapshot::max_events>        m_events{};
+    Event                                                 m_dispatch{};
+    std::atomic<std::uint64_t>                            m_unhandled{0};
+};
+
+}  // namespace tao
+
+#endif
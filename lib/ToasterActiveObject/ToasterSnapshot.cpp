@@ -0,0 +1,80 @@
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "ToasterSnapshot.hpp"
+
+namespace
+{
+std::size_t file_size_for(std::size_t count)
+{
+    return sizeof(tao::SnapshotHeader) + count * sizeof(tao::ToasterSnapshot);
+}
+
+// Size to create path with, 0 to map it as it is
+std::size_t size_to_create(const std::string &path, std::size_t count)
+{
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) > 0 && !ec)
+    {
+        return 0;
+    }
+    if (count == 0)
+    {
+        throw std::runtime_error(path + ": no snapshot file to open");
+    }
+    return file_size_for(count);
+}
+}  // namespace
+
+/* *************************************************************************************************
+Implementations of tao::SnapshotFile
+************************************************************************************************* */
+
+tao::SnapshotFile::SnapshotFile(const std::string &path, std::size_t count)
+    : m_file{path, MappedFile::Mode::read_write, size_to_create(path, count)}
+{
+    SnapshotHeader header;
+    if (m_file.size() < sizeof(SnapshotHeader))
+    {
+        throw std::runtime_error(path + ": too short to be a snapshot file");
+    }
+    std::memcpy(&header, m_file.data(), sizeof(header));
+
+    const SnapshotHeader blank{};
+    if (std::memcmp(&header, &blank, sizeof(header)) == 0)
+    {
+        // Freshly created, every slot is zeroed hence empty
+        std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+        header.version     = snapshot_version;
+        header.count       = static_cast<std::uint32_t>(count);
+        header.record_size = sizeof(ToasterSnapshot);
+        std::memcpy(m_file.data(), &header, sizeof(header));
+    }
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    {
+        throw std::runtime_error(path + ": not a snapshot file");
+    }
+    if (header.version != snapshot_version || header.record_size != sizeof(ToasterSnapshot))
+    {
+        throw std::runtime_error(path + ": unsupported snapshot version");
+    }
+    if (count != 0 && header.count != count)
+    {
+        throw std::runtime_error(path + ": holds " + std::to_string(header.count)
+                                 + " snapshots, not " + std::to_string(count));
+    }
+    if (file_size_for(header.count) > m_file.size())
+    {
+        throw std::runtime_error(path + ": truncated snapshot file");
+    }
+
+    // The header keeps the slots 16 bytes aligned within the (page aligned) mapping
+    m_slots = reinterpret_cast<ToasterSnapshot *>(m_file.data() + sizeof(SnapshotHeader));
+    m_count = header.count;
+}
+
+void tao::SnapshotFile::sync()
+{
+    m_file.sync(0, file_size_for(m_count));
+}
@@ -0,0 +1,83 @@
+#ifndef __TOASTERSNAPSHOT__
+#define __TOASTERSNAPSHOT__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "MappedFile.hpp"
+
+namespace tao
+{
+
+/* Everything a Toaster needs to resume where it stopped, in a fixed 64 bytes so that a fleet of
+them is one flat array. Events are stored in their IncomingEventWrapper::encode() form, the
+oldest first; the ones that don't fit are only counted. */
+struct ToasterSnapshot
+{
+    static constexpr std::size_t max_queued = 24;
+
+    std::uint8_t                          state;      // StateValue, UNKNOWN for an empty slot
+    std::uint8_t                          door_open;  // 1 when the door is open
+    std::uint16_t                         queued_count;
+    float                                 target_temp;
+    std::int32_t                          timer_remaining_ms;  // -1 when the timer isn't armed
+    std::uint32_t                         queued_dropped;
+    std::array<std::uint16_t, max_queued> queued;
+};
+
+static_assert(std::is_trivially_copyable_v<ToasterSnapshot>, "ToasterSnapshot is copied as bytes");
+static_assert(sizeof(ToasterSnapshot) == 64, "ToasterSnapshot layout is part of the file format");
+
+/* On disk layout of a fleet: one SnapshotHeader followed by count ToasterSnapshots, in the byte
+order of the host that wrote it */
+inline constexpr char          snapshot_magic[4] = {'T', 'S', 'N', 'P'};
+inline constexpr std::uint32_t snapshot_version  = 1;
+
+struct SnapshotHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint32_t count;        // Number of snapshots following the header
+    std::uint32_t record_size;  // sizeof(ToasterSnapshot) of the writer
+};
+
+static_assert(sizeof(SnapshotHeader) == 16, "SnapshotHeader layout is part of the file format");
+
+/* A fleet snapshot file mapped read-write, one slot per toaster. Snapshots are written straight
+into the mapping and restored straight out of it, sync() makes them durable.
+
+A missing or empty file is created with count empty slots. An existing one must be a snapshot file,
+of count slots unless count is 0. Throws std::runtime_error otherwise (std::system_error when the
+file can't be opened or mapped). */
+class SnapshotFile
+{
+   public:
+    explicit SnapshotFile(const std::string &path, std::size_t count = 0);
+
+    std::size_t size() const
+    {
+        return m_count;
+    }
+    ToasterSnapshot &operator[](std::size_t i)
+    {
+        return m_slots[i];
+    }
+    const ToasterSnapshot &operator[](std::size_t i) const
+    {
+        return m_slots[i];
+    }
+
+    void sync();
+
+   private:
+    MappedFile       m_file;
+    ToasterSnapshot *m_slots{nullptr};
+    std::size_t      m_count{0};
+};
+
+}  // namespace tao
+
+#endif
@@ -0,0 +1,69 @@
+#include <iomanip>
+
+#include "ToasterActiveObject.hpp"
+
+std::vector<tao::StepRecord> tao::TraceRecorder::snapshot() const
+{
+    const std::uint64_t     end   = recorded();
+    const std::uint64_t     begin = end > m_capacity ? end - m_capacity : 0;
+    std::vector<StepRecord> steps;
+    steps.reserve(end - begin);
+
+    for (std::uint64_t index = begin; index < end; index++)
+    {
+        const Slot &slot = m_slots[index % m_capacity];
+        StepRecord  copy;
+        slot.lock.read([&]() { copy = slot.record; });
+        if (copy.index == index)
+        {
+            // Otherwise the writer lapped this slot while it was being copied
+            steps.push_back(copy);
+        }
+    }
+    return steps;
+}
+
+void tao::export_chrome_trace(std::ostream &out, const std::vector<StepRecord> &steps, int pid)
+{
+    const int steps_tid  = 1;
+    const int states_tid = 2;
+
+    // Timestamps are in microseconds, relative to the first step
+    const std::int64_t origin_ns = steps.empty() ? 0 : steps.front().timestamp_ns;
+    auto               us        = [origin_ns](std::int64_t ns)
+    { return static_cast<double>(ns - origin_ns) / 1000.0; };
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << steps_tid
+        << ",\"args\":{\"name\":\"steps\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << states_tid
+        << ",\"args\":{\"name\":\"states\"}}";
+
+    std::size_t state_since = 0;
+    for (std::size_t i = 0; i < steps.size(); i++)
+    {
+        const StepRecord &step = steps[i];
+        out << ",\n{\"name\":\"" << stringify(step.event) << "\",\"cat\":\"step\",\"ph\":\"X\""
+            << ",\"ts\":" << us(step.timestamp_ns) << ",\"dur\":" << step.duration_ns / 1000.0
+            << ",\"pid\":" << pid << ",\"tid\":" << steps_tid << ",\"args\":{\"index\":"
+            << step.index << ",\"before\":\"" << stringify(step.before) << "\",\"after\":\""
+            << stringify(step.after) << "\",\"queue_depth\":" << step.queue_depth << "}}";
+        out << ",\n{\"name\":\"queue_depth\",\"ph\":\"C\",\"ts\":" << us(step.timestamp_ns)
+            << ",\"pid\":" << pid << ",\"args\":{\"depth\":" << step.queue_depth << "}}";
+
+        // A state span closes at the end of the step that left it, or of the last step
+        const bool last = i + 1 == steps.size();
+        if (step.after != step.before || last)
+        {
+            const StepRecord &first = steps[state_since];
+            const std::int64_t end_ns = step.timestamp_ns + step.duration_ns;
+            out << ",\n{\"name\":\"" << stringify(first.before)
+                << "\",\"cat\":\"state\",\"ph\":\"X\",\"ts\":" << us(first.timestamp_ns)
+                << ",\"dur\":" << (end_ns - first.timestamp_ns) / 1000.0 << ",\"pid\":" << pid
+                << ",\"tid\":" << states_tid << "}";
+            state_since = i + 1;
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,112 @@
+#ifndef __TRACERECORDER__
+#define __TRACERECORDER__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "Seqlock.hpp"
+
+// namespace toaster active object - tao
+namespace tao
+{
+enum class InternalEvent;
+enum class StateValue;
+
+// One run-to-completion step of a Toaster
+struct StepRecord
+{
+    std::uint64_t index;         // Position in the recording, never reused
+    std::int64_t  timestamp_ns;  // Steady clock, when the step started
+    std::uint32_t duration_ns;   // process_internal_event + transition_state
+    std::uint32_t queue_depth;   // Events still waiting once this one was dequeued
+    InternalEvent event;
+    StateValue    before;
+    StateValue    after;
+};
+
+/* Always-on recorder of the last steps of a state machine. record() belongs to the toaster's own
+thread and never blocks nor allocates. snapshot() may run on any thread: every slot sits behind its
+own seqlock, so a reader only ever retries the slot being written and skips the ones overwritten
+while it was copying. */
+class TraceRecorder
+{
+   public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TraceRecorder(std::size_t capacity = 1024)
+        : m_capacity{capacity > 0 ? capacity : 1}, m_slots{new Slot[m_capacity]}
+    {
+    }
+
+    void record(InternalEvent event, StateValue before, StateValue after,
+                clock::time_point started, clock::time_point finished, std::size_t queue_depth)
+    {
+        if (!m_enabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        const std::uint64_t index = m_next.load(std::memory_order_relaxed);
+        Slot               &slot  = m_slots[index % m_capacity];
+        slot.lock.write(
+            [&]()
+            {
+                slot.record = StepRecord{
+                    index,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        started.time_since_epoch())
+                        .count(),
+                    static_cast<std::uint32_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started)
+                            .count()),
+                    static_cast<std::uint32_t>(queue_depth),
+                    event,
+                    before,
+                    after};
+            });
+        m_next.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies the recorded steps still in the ring, oldest first
+    std::vector<StepRecord> snapshot() const;
+
+    void set_enabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    // Steps recorded so far, including the ones the ring already forgot
+    std::uint64_t recorded() const
+    {
+        return m_next.load(std::memory_order_acquire);
+    }
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+   private:
+    struct Slot
+    {
+        Seqlock    lock;
+        StepRecord record{};
+    };
+
+    const std::size_t          m_capacity;
+    std::unique_ptr<Slot[]>    m_slots;
+    std::atomic<std::uint64_t> m_next{0};
+    std::atomic<bool>          m_enabled{true};
+};
+
+/* Writes steps as Chrome trace event JSON, which chrome://tracing and ui.perfetto.dev both open.
+Every step becomes a complete event named after its event on the "steps" track, the time spent in
+each state a span on the "states" track, and the queue depth a counter. */
+void export_chrome_trace(std::ostream &out, const std::vector<StepRecord> &steps,
+                         int pid = 1);
+
+}  // namespace tao
+
+#endif
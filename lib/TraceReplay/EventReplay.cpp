@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "EventReplay.hpp"
+#include "MappedFile.hpp"
+#include "MockObjects.hpp"
+
+namespace
+{
+std::uint8_t state_byte(tao::StateValue state)
+{
+    return static_cast<std::uint8_t>(state);
+}
+tao::StateValue state_of(std::uint8_t state)
+{
+    return state < tao::state_count ? static_cast<tao::StateValue>(state)
+                                    : tao::StateValue::UNKNOWN;
+}
+}  // namespace
+
+/* *************************************************************************************************
+Recordings
+************************************************************************************************* */
+
+std::vector<TraceReplay::RecordedStep> TraceReplay::recording_from_steps(
+    const std::vector<tao::StepRecord> &steps)
+{
+    std::vector<RecordedStep> recording;
+    recording.reserve(steps.size());
+    constexpr std::uint32_t max_depth = std::numeric_limits<std::uint16_t>::max();
+    for (const auto &step : steps)
+        recording.push_back(RecordedStep{
+            step.timestamp_ns, tao::IncomingEventWrapper{step.event}.encode(),
+            state_byte(step.before), state_byte(step.after),
+            static_cast<std::uint16_t>(std::min<std::uint32_t>(step.queue_depth, max_depth)), 0});
+    return recording;
+}
+
+std::vector<TraceReplay::RecordedStep> TraceReplay::recording_from_journal(
+    const std::vector<JournalRecord> &records, std::uint32_t source)
+{
+    std::vector<RecordedStep> recording;
+    for (const auto &record : records)
+        if (record.source == source)
+        {
+            const std::uint16_t flags =
+                (record.flags & JournalRecord::prioritized) ? RecordedStep::prioritized : 0;
+            recording.push_back(RecordedStep{record.timestamp_ns, record.event,
+                                             state_byte(tao::StateValue::UNKNOWN),
+                                             state_byte(tao::StateValue::UNKNOWN),
+                                             record.waiting(), flags});
+        }
+    return recording;
+}
+
+void TraceReplay::write_recording(const std::string &path, const std::vector<RecordedStep> &steps)
+{
+    RecordingHeader header{};
+    std::memcpy(header.magic, recording_magic, sizeof(recording_magic));
+    header.version = recording_version;
+    header.count   = steps.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(steps.data()),
+              static_cast<std::streamsize>(steps.size() * sizeof(RecordedStep)));
+    if (!out)
+    {
+        throw std::runtime_error(path + ": could not write recording");
+    }
+}
+
+std::vector<TraceReplay::RecordedStep> TraceReplay::read_recording(const std::string &path)
+{
+    MappedFile file{path, MappedFile::Mode::read_only};
+    if (file.size() < sizeof(RecordingHeader))
+    {
+        throw std::runtime_error(path + ": too short to be a recording");
+    }
+    RecordingHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, recording_magic, sizeof(recording_magic)) != 0)
+    {
+        throw std::runtime_error(path + ": not a recording");
+    }
+    if (header.version != recording_version && header.version != 1)
+    {
+        throw std::runtime_error(path + ": unsupported recording version");
+    }
+    if (header.count > (file.size() - sizeof(RecordingHeader)) / sizeof(RecordedStep))
+    {
+        throw std::runtime_error(path + ": truncated recording");
+    }
+
+    const auto *first = reinterpret_cast<const RecordedStep *>(file.data() + sizeof(header));
+    std::vector<RecordedStep> steps(first, first + header.count);
+    if (header.version == 1)
+    {
+        for (auto &step : steps)
+            step.flags = 0;
+    }
+    return steps;
+}
+
+/* *************************************************************************************************
+Replay
+************************************************************************************************* */
+
+TraceReplay::ReplayReport TraceReplay::replay_events(const std::vector<RecordedStep> &recording,
+                                                     std::size_t max_mismatches)
+{
+    ReplayReport report;
+    const auto   started = std::chrono::steady_clock::now();
+
+    // Never run: whatever the toaster arms or posts on it never happens
+    boost::asio::io_context ioc;
+    Toaster                 toaster(ioc.get_executor(),
+                                    std::make_shared<MockObjects::InertHeater>(),
+                                    std::make_shared<MockObjects::InertSensor>());
+    toaster.m_trace.set_enabled(false);
+
+    const tao::StateValue initial =
+        recording.empty() ? tao::StateValue::UNKNOWN : state_of(recording.front().before);
+    if (initial != tao::StateValue::UNKNOWN && initial != toaster.m_state->type())
+    {
+        tao::ToasterSnapshot snapshot = toaster.snapshot();
+        snapshot.state                = state_byte(initial);
+        toaster.restore(snapshot);
+    }
+
+    // One step for the recorded step i
+    auto dispatch = [&](std::size_t i)
+    {
+        const RecordedStep      &step = recording[i];
+        const tao::InternalEvent event =
+            tao::IncomingEventWrapper::decode(step.event).map_incoming_event_to_internal_event();
+        const tao::StateValue before = toaster.m_state->type();
+        toaster.state_machine_iteration(event);
+        const tao::StateValue after = toaster.m_state->type();
+
+        const tao::StateValue expected_before = state_of(step.before);
+        const tao::StateValue expected_after  = state_of(step.after);
+        if ((expected_before != tao::StateValue::UNKNOWN && expected_before != before)
+            || (expected_after != tao::StateValue::UNKNOWN && expected_after != after))
+        {
+            if (report.mismatches.size() < max_mismatches)
+            {
+                const std::int64_t offset = step.timestamp_ns - recording.front().timestamp_ns;
+                report.mismatches.push_back(ReplayMismatch{i, offset, event, expected_before,
+                                                           expected_after, before, after});
+            }
+            report.mismatch_count++;
+        }
+    };
+
+    /* The queue of the toaster, as it was: before a step is put, the ones ahead of it in the queue
+    are dispatched until no more than its queue_depth are left. A prioritized one then goes in
+    front of those, as put_prioritized() did */
+    std::deque<std::size_t> queue;
+    for (std::size_t i = 0; i < recording.size(); i++)
+    {
+        while (queue.size() > recording[i].queue_depth)
+        {
+            dispatch(queue.front());
+            queue.pop_front();
+        }
+        if (recording[i].flags & RecordedStep::prioritized)
+        {
+            queue.push_front(i);
+        }
+        else
+        {
+            queue.push_back(i);
+        }
+    }
+    for (std::size_t queued : queue)
+        dispatch(queued);
+
+    report.steps       = recording.size();
+    report.final_state = toaster.m_state->type();
+    if (!recording.empty())
+    {
+        report.recorded_duration = std::chrono::nanoseconds(recording.back().timestamp_ns
+                                                            - recording.front().timestamp_ns);
+    }
+    report.replay_duration = std::chrono::steady_clock::now() - started;
+    return report;
+}
+
+std::ostream &TraceReplay::operator<<(std::ostream &os, const ReplayReport &report)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    os << report.steps << " steps, " << ms(report.recorded_duration).count()
+       << " ms recorded, replayed in " << ms(report.replay_duration).count() << " ms, ending in "
+       << report.final_state << ": ";
+    if (report.matched())
+    {
+        return os << "trajectory matches";
+    }
+    os << report.mismatch_count << " mismatching steps";
+    for (const auto &mismatch : report.mismatches)
+        os << "\n    step " << mismatch.step << " (+"
+           << ms(std::chrono::nanoseconds(mismatch.offset_ns)).count() << " ms) "
+           << mismatch.event << ": expected " << mismatch.expected_before << " -> "
+           << mismatch.expected_after << ", got " << mismatch.actual_before << " -> "
+           << mismatch.actual_after;
+    return os;
+}
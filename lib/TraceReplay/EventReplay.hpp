@@ -0,0 +1,71 @@
+#ifndef __EVENTREPLAY__
+#define __EVENTREPLAY__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "JournalFormat.hpp"
+#include "ToasterActiveObject.hpp"
+#include "TraceFormat.hpp"
+
+namespace TraceReplay
+{
+
+// What a toaster went through, out of its TraceRecorder
+std::vector<RecordedStep> recording_from_steps(const std::vector<tao::StepRecord> &steps);
+/* The events journaled for source, in journal order, prioritized ones flagged as such and with the
+number of events they found waiting in the queue as queue_depth. There are no states to check
+against, so replaying them only rebuilds the state the toaster ended in */
+std::vector<RecordedStep> recording_from_journal(const std::vector<JournalRecord> &records,
+                                                 std::uint32_t                     source);
+
+void write_recording(const std::string &path, const std::vector<RecordedStep> &steps);
+// Throws std::runtime_error when the file is not a valid recording
+std::vector<RecordedStep> read_recording(const std::string &path);
+
+// A step that didn't go the way it was recorded
+struct ReplayMismatch
+{
+    std::size_t        step;
+    std::int64_t       offset_ns;  // From the first step of the recording
+    tao::InternalEvent event;
+    tao::StateValue    expected_before;
+    tao::StateValue    expected_after;
+    tao::StateValue    actual_before;
+    tao::StateValue    actual_after;
+};
+
+struct ReplayReport
+{
+    std::size_t                 steps{0};
+    std::size_t                 mismatch_count{0};
+    std::vector<ReplayMismatch> mismatches;  // The first ones only
+    tao::StateValue             final_state{tao::StateValue::UNKNOWN};
+    std::chrono::nanoseconds    recorded_duration{0};  // First to last step of the recording
+    std::chrono::nanoseconds    replay_duration{0};    // Wall clock time the replay took
+
+    bool matched() const
+    {
+        return mismatch_count == 0;
+    }
+};
+std::ostream &operator<<(std::ostream &os, const ReplayReport &report);
+
+/* Feeds a recording to a fresh toaster, one run-to-completion step per recorded step, on the
+calling thread and as fast as it goes. Steps are dispatched in the order the toaster dispatched
+them: each one is queued once the queue is down to its queue_depth, prioritized ones at the front,
+so an alarm overtakes the events it overtook then (steps of a trace are in dispatch order already,
+none is prioritized). Timestamps are only reported, nothing waits for the recorded time to pass.
+The toaster has inert mocks for heater and sensor and its timers never expire, timer events come
+from the recording like any other event. It starts from the state the recording starts from, then
+every step is checked against the recorded states (UNKNOWN ones excepted) */
+ReplayReport replay_events(const std::vector<RecordedStep> &recording,
+                           std::size_t                      max_mismatches = 16);
+
+}  // namespace TraceReplay
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __TRACEFORMAT__
+#define __TRACEFORMAT__
+
+#include <cstdint>
+
+namespace TraceReplay
+{
+
+/* On disk layout of a temperature trace: one TraceHeader followed by count TraceRecords, in the
+byte order of the host that wrote it. Records are sorted by offset_ms, so a file can be walked
+front to back straight out of its mapping, without any parsing. */
+inline constexpr char          trace_magic[4] = {'T', 'T', 'R', 'C'};
+inline constexpr std::uint32_t trace_version  = 1;
+
+struct TraceHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint64_t count;  // Number of records following the header
+};
+
+struct TraceRecord
+{
+    std::uint32_t offset_ms;  // From the start of the recording
+    float         temperature;
+};
+
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader layout is part of the file format");
+static_assert(sizeof(TraceRecord) == 8, "TraceRecord layout is part of the file format");
+
+/* On disk layout of an event recording: one RecordingHeader followed by count RecordedSteps, in
+the order the toaster went through them. States are tao::StateValue, UNKNOWN when not recorded.
+Version 1 had a 32 bit queue_depth in place of queue_depth and flags, it is read with no flags. */
+inline constexpr char          recording_magic[4] = {'T', 'E', 'V', 'R'};
+inline constexpr std::uint32_t recording_version  = 2;
+
+struct RecordingHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint64_t count;  // Number of steps following the header
+};
+
+struct RecordedStep
+{
+    std::int64_t  timestamp_ns;  // When the step happened, on the clock of the recording
+    std::uint16_t event;         // tao::IncomingEventWrapper::encode()
+    std::uint8_t  before;        // State the step started from
+    std::uint8_t  after;         // State the step ended in
+    std::uint16_t queue_depth;   // Events waiting once it was dequeued, or when put (journal)
+    std::uint16_t flags;
+
+    static constexpr std::uint16_t prioritized = 1;  // Was put at the front of the queue
+};
+
+static_assert(sizeof(RecordingHeader) == 16, "RecordingHeader layout is part of the file format");
+static_assert(sizeof(RecordedStep) == 16, "RecordedStep layout is part of the file format");
+
+}  // namespace TraceReplay
+
+#endif
@@ -0,0 +1,251 @@
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "TraceReplay.hpp"
+
+/* *************************************************************************************************
+Implementations of TraceReplay::TraceFile
+************************************************************************************************* */
+
+TraceReplay::TraceFile::TraceFile(const std::string &path)
+    : m_file{path, MappedFile::Mode::read_only}
+{
+    if (m_file.size() < sizeof(TraceHeader))
+    {
+        throw std::runtime_error(path + ": too short to be a trace");
+    }
+    TraceHeader header;
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    if (std::memcmp(header.magic, trace_magic, sizeof(trace_magic)) != 0)
+    {
+        throw std::runtime_error(path + ": not a trace file");
+    }
+    if (header.version != trace_version)
+    {
+        throw std::runtime_error(path + ": unsupported trace version");
+    }
+    if (header.count > (m_file.size() - sizeof(TraceHeader)) / sizeof(TraceRecord))
+    {
+        throw std::runtime_error(path + ": truncated trace");
+    }
+
+    // The header keeps the records 8 bytes aligned within the (page aligned) mapping
+    m_records = reinterpret_cast<const TraceRecord *>(m_file.data() + sizeof(TraceHeader));
+    m_count   = header.count;
+    m_file.advise_sequential();
+}
+
+/* *************************************************************************************************
+Free functions
+************************************************************************************************* */
+
+void TraceReplay::write_trace(const std::string &path, const std::vector<TraceRecord> &records)
+{
+    TraceHeader header{};
+    std::memcpy(header.magic, trace_magic, sizeof(trace_magic));
+    header.version = trace_version;
+    header.count   = records.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(TraceRecord)));
+    if (!out)
+    {
+        throw std::runtime_error(path + ": could not write trace");
+    }
+}
+
+std::vector<TraceReplay::TraceRecord> TraceReplay::parse_csv(std::istream &in)
+{
+    std::vector<TraceRecord> records;
+    std::string              line;
+    std::size_t              line_number = 0;
+
+    while (std::getline(in, line))
+    {
+        line_number++;
+        if (line.empty() || line[0] == '#' || line == "\r")
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        double             offset_ms;
+        char               comma;
+        float              temperature;
+        if (!(fields >> offset_ms >> comma >> temperature) || comma != ',' || offset_ms < 0)
+        {
+            if (line_number == 1 && records.empty())
+            {
+                // Column names
+                continue;
+            }
+            throw std::runtime_error("line " + std::to_string(line_number) + ": malformed");
+        }
+        // Past 49 days, or inf / nan, wouldn't fit the uint32 offset
+        if (!(offset_ms <= static_cast<double>(std::numeric_limits<std::uint32_t>::max())))
+        {
+            throw std::runtime_error("line " + std::to_string(line_number)
+                                     + ": offset out of range");
+        }
+
+        const TraceRecord record{static_cast<std::uint32_t>(offset_ms), temperature};
+        if (!records.empty() && record.offset_ms < records.back().offset_ms)
+        {
+            throw std::runtime_error("line " + std::to_string(line_number) + ": out of order");
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+/* *************************************************************************************************
+Implementations of TraceReplay::TraceReplaySensor
+************************************************************************************************* */
+
+TraceReplay::TraceReplaySensor::TraceReplaySensor(const std::string &path, Pacing pacing,
+                                                  float error, std::size_t history_size)
+    : m_trace{path},
+      m_pacing{pacing},
+      m_error{error},
+      m_history{history_size},
+      m_temperature{m_trace.size() > 0 ? m_trace[0].temperature : 0.0f},
+      m_target{m_temperature.load()}
+{
+    // Initializes common protected members from interface
+    m_status      = Status::Off;
+    m_curr_temp   = m_temperature;
+    m_target_temp = m_target;
+}
+
+TraceReplay::TraceReplaySensor::~TraceReplaySensor()
+{
+    stop();
+}
+
+void TraceReplay::TraceReplaySensor::initialize(SensorCallback cb)
+{
+    m_callback = std::move(cb);
+}
+
+void TraceReplay::TraceReplaySensor::turn_on()
+{
+    m_status = Status::On;
+}
+
+void TraceReplay::TraceReplaySensor::turn_off()
+{
+    m_status = Status::Off;
+}
+
+float TraceReplay::TraceReplaySensor::get_temperature() const
+{
+    return m_temperature.load(std::memory_order_relaxed);
+}
+
+void TraceReplay::TraceReplaySensor::set_target_temperature(float temp)
+{
+    // Called from the toaster thread: the replay side picks the change up on its next record
+    if (m_target.exchange(temp, std::memory_order_relaxed) != temp)
+    {
+        m_target_changed.store(true, std::memory_order_release);
+    }
+}
+
+Sensors::ITempSensor<TraceReplay::SensorCallback>::Status
+TraceReplay::TraceReplaySensor::get_status() const
+{
+    return m_status;
+}
+
+void TraceReplay::TraceReplaySensor::start()
+{
+    if (m_thread.joinable())
+    {
+        return;
+    }
+    m_stop_requested = false;
+    m_thread = std::thread(&TraceReplaySensor::replay_loop, this);
+}
+
+void TraceReplay::TraceReplaySensor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop_requested = true;
+    }
+    m_cv.notify_all();
+    wait();
+}
+
+void TraceReplay::TraceReplaySensor::wait()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+bool TraceReplay::TraceReplaySensor::step()
+{
+    const std::size_t position = m_position.load(std::memory_order_relaxed);
+    if (position == m_trace.size())
+    {
+        return false;
+    }
+    if (position == 0)
+    {
+        m_origin = clock::now();
+    }
+    replay(m_trace[position]);
+    m_position.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void TraceReplay::TraceReplaySensor::replay_loop()
+{
+    const clock::time_point started  = clock::now();
+    const std::uint32_t     first_ms = finished() ? 0 : m_trace[position()].offset_ms;
+    while (!finished())
+    {
+        if (m_pacing == Pacing::real_time)
+        {
+            const auto due = started + std::chrono::milliseconds(
+                                           m_trace[position()].offset_ms - first_ms);
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_cv.wait_until(lock, due, [this]() { return m_stop_requested.load(); }))
+            {
+                return;
+            }
+        }
+        else if (m_stop_requested.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        step();
+    }
+}
+
+void TraceReplay::TraceReplaySensor::replay(const TraceRecord &record)
+{
+    const clock::time_point recorded_at = m_origin + std::chrono::milliseconds(record.offset_ms);
+
+    m_temperature.store(record.temperature, std::memory_order_relaxed);
+    m_history.push(record.temperature, recorded_at);
+
+    if (m_target_changed.exchange(false, std::memory_order_acquire))
+    {
+        // A new target makes the last published classification meaningless
+        m_classifier.invalidate();
+    }
+    auto evt = m_classifier.update(record.temperature, m_target.load(std::memory_order_relaxed),
+                                   m_error, m_publish_policy, recorded_at);
+    if (evt && m_callback)
+    {
+        m_callback(TempSensorEvent{*evt});
+    }
+}
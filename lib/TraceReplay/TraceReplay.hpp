@@ -0,0 +1,137 @@
+#ifndef __TRACEREPLAY__
+#define __TRACEREPLAY__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Events.hpp"
+#include "MappedFile.hpp"
+#include "Sensors.hpp"
+#include "TraceFormat.hpp"
+
+namespace TraceReplay
+{
+
+using SensorCallback = std::function<void(const TempSensorEvent &)>;
+
+// A trace file mapped read-only. Throws std::runtime_error when the file is not a valid trace
+class TraceFile
+{
+   public:
+    explicit TraceFile(const std::string &path);
+
+    const TraceRecord *begin() const
+    {
+        return m_records;
+    }
+    const TraceRecord *end() const
+    {
+        return m_records + m_count;
+    }
+    std::size_t size() const
+    {
+        return m_count;
+    }
+    const TraceRecord &operator[](std::size_t i) const
+    {
+        return m_records[i];
+    }
+
+   private:
+    MappedFile         m_file;
+    const TraceRecord *m_records{nullptr};
+    std::size_t        m_count{0};
+};
+
+void write_trace(const std::string &path, const std::vector<TraceRecord> &records);
+
+/* Parses "offset_ms,temperature" lines. Blank lines, '#' comments and a non numeric header line
+are skipped. Throws std::runtime_error on malformed or out of order lines */
+std::vector<TraceRecord> parse_csv(std::istream &in);
+
+/* Temperature sensor replaying a recorded trace instead of measuring anything. Each record is
+classified and published exactly like TempSensorDemo does with its readings, so it can be handed
+to a Toaster in its place. Replay either runs on its own thread (start()), paced in real time or
+as fast as possible, or is driven one record at a time with step(). Readings are timestamped with
+the time of the recording, so history statistics and rate limiting do not depend on the pacing. */
+class TraceReplaySensor : public Sensors::ITempSensor<SensorCallback>
+{
+   public:
+    using clock = std::chrono::steady_clock;
+
+    enum class Pacing
+    {
+        real_time,
+        as_fast_as_possible,
+    };
+
+    TraceReplaySensor(const std::string &path, Pacing pacing = Pacing::real_time,
+                      float error = 2.0f, std::size_t history_size = 64);
+    ~TraceReplaySensor();
+
+    void   initialize(SensorCallback cb) override;
+    void   turn_on() override;
+    void   turn_off() override;
+    float  get_temperature() const override;
+    void   set_target_temperature(float temp) override;
+    Status get_status() const override;
+
+    const Sensors::TempHistory *history() const override
+    {
+        return &m_history;
+    }
+
+    void start();
+    void stop();
+    // Blocks until the replay thread went through the whole trace (or was stopped)
+    void wait();
+    // Replays the next record on the calling thread, false once the trace is exhausted. Not to be
+    // mixed with a running replay thread
+    bool step();
+
+    bool finished() const
+    {
+        return m_position.load(std::memory_order_acquire) == m_trace.size();
+    }
+    std::size_t position() const
+    {
+        return m_position.load(std::memory_order_acquire);
+    }
+    std::size_t size() const
+    {
+        return m_trace.size();
+    }
+
+   private:
+    void replay_loop();
+    void replay(const TraceRecord &record);
+
+    TraceFile                m_trace;
+    Pacing                   m_pacing;
+    float                    m_error;
+    SensorCallback           m_callback;
+    Sensors::TempClassifier  m_classifier;
+    Sensors::TempHistory     m_history;
+    clock::time_point        m_origin{};
+    std::atomic<float>       m_temperature;
+    std::atomic<float>       m_target;
+    std::atomic<bool>        m_target_changed{false};
+    std::atomic<std::size_t> m_position{0};
+
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool>       m_stop_requested{false};
+};
+
+}  // namespace TraceReplay
+
+#endif
@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "MockObjects.hpp"
+#include "ThreadSafeQueue.hpp"
+#include "ToasterActiveObject.hpp"
+
+/* Performance regression gate: short microbenchmarks compared against the baseline checked in
+next to this file (PERF_BASELINE_PATH). Measures are not kept in ns, which would only hold on the
+machine that recorded them, but as a ratio to a calibration loop timed by the same process. A
+measure fails when its ratio exceeds the baseline one by more than its tolerance (1.0 lets it take
+twice as long).
+
+    PERF_GATE_TOLERANCE=<ratio>  overrides every tolerance of the baseline
+    PERF_GATE_UPDATE=1           measures only, then rewrites the baseline with the results
+
+Each measure is the fastest of several repetitions, which is what keeps it steady on a loaded
+machine. Hardware counters (perf_event_open) are recorded next to it when the kernel allows it. */
+
+namespace
+{
+
+constexpr int repetitions = 15;
+
+bool update_mode()
+{
+    const char *update = std::getenv("PERF_GATE_UPDATE");
+    return update != nullptr && std::string(update) == "1";
+}
+
+// Counters of the calling thread, user space only. Each one is optional
+class PerfCounters
+{
+   public:
+    PerfCounters()
+    {
+        m_fds[0] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        m_fds[1] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        m_fds[2] = open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+    }
+    ~PerfCounters()
+    {
+        for (int fd : m_fds)
+            if (fd >= 0)
+                ::close(fd);
+    }
+
+    void start()
+    {
+        for (int fd : m_fds)
+            if (fd >= 0)
+            {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+    }
+    void stop()
+    {
+        for (int fd : m_fds)
+            if (fd >= 0)
+                ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    // name -> value of the counters that could be opened
+    std::map<std::string, long long> read() const
+    {
+        static const char *names[] = {"instructions", "cache_misses", "context_switches"};
+        std::map<std::string, long long> result;
+        for (int i = 0; i < 3; i++)
+        {
+            long long value;
+            if (m_fds[i] >= 0 && ::read(m_fds[i], &value, sizeof(value)) == sizeof(value))
+            {
+                result[names[i]] = value;
+            }
+        }
+        return result;
+    }
+
+   private:
+    static int open(std::uint32_t type, std::uint64_t config)
+    {
+        perf_event_attr attr{};
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    int m_fds[3];
+};
+
+struct Baseline
+{
+    double                        tolerance{1.0};
+    std::map<std::string, double> ratios;  // ns per op over calibration_ns_per_op()
+    std::map<std::string, double> tolerances;
+};
+
+Baseline load_baseline()
+{
+    Baseline                    baseline;
+    boost::property_tree::ptree tree;
+    boost::property_tree::read_json(PERF_BASELINE_PATH, tree);
+    baseline.tolerance = tree.get<double>("tolerance", baseline.tolerance);
+    for (const auto &[name, entry] : tree.get_child("benchmarks"))
+    {
+        baseline.ratios[name] = entry.get<double>("ratio");
+        if (auto tolerance = entry.get_optional<double>("tolerance"))
+        {
+            baseline.tolerances[name] = *tolerance;
+        }
+    }
+    if (const char *tolerance = std::getenv("PERF_GATE_TOLERANCE"))
+    {
+        baseline.tolerance = std::stod(tolerance);
+        baseline.tolerances.clear();
+    }
+    return baseline;
+}
+
+// Written back as the new baseline in update mode
+std::map<std::string, double> &results()
+{
+    static std::map<std::string, double> measured;
+    return measured;
+}
+
+class PerfGateEnvironment : public ::testing::Environment
+{
+   public:
+    void TearDown() override
+    {
+        if (!update_mode() || results().empty())
+        {
+            return;
+        }
+        // Measures that didn't run (filtered out) and tolerances are kept, values are replaced
+        Baseline previous = load_baseline();
+        for (const auto &[name, ratio] : results())
+            previous.ratios[name] = ratio;
+
+        std::ofstream out(PERF_BASELINE_PATH);
+        out << "{\n    \"tolerance\": " << previous.tolerance << ",\n    \"benchmarks\": {\n";
+        std::size_t written = 0;
+        for (const auto &[name, ratio] : previous.ratios)
+        {
+            out << "        \"" << name << "\": {\"ratio\": " << std::fixed
+                << std::setprecision(2) << ratio << std::defaultfloat;
+            auto tolerance = previous.tolerances.find(name);
+            if (tolerance != previous.tolerances.end())
+            {
+                out << ", \"tolerance\": " << tolerance->second;
+            }
+            out << "}" << (++written < previous.ratios.size() ? "," : "") << "\n";
+        }
+        out << "    }\n}\n";
+        std::cout << "[perf gate] Baseline updated: " << PERF_BASELINE_PATH << std::endl;
+    }
+};
+[[maybe_unused]] const auto *const environment =
+    ::testing::AddGlobalTestEnvironment(new PerfGateEnvironment);
+
+// Fastest of the repetitions of body (which performs ops operations), in ns per operation
+template <class Body>
+double best_ns_per_op(long ops, Body body)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; r++)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        body();
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count() / ops);
+    }
+    return best;
+}
+
+/* The unit of every measure: a loop of dependent integer operations over a small table, the kind
+of work the measures do (branches, L1 loads and stores) without any system call. Timed right
+before each measure, so that both see the same clock frequency and the same load */
+double calibration_ns_per_op()
+{
+    constexpr long         ops = 1000000;
+    std::uint32_t          table[256]{};
+    volatile std::uint32_t sink  = 0;
+    std::uint32_t          state = 2463534242u;
+    return best_ns_per_op(ops,
+                          [&]()
+                          {
+                              for (long i = 0; i < ops; i++)
+                              {
+                                  state ^= state << 13;
+                                  state ^= state >> 17;
+                                  state ^= state << 5;
+                                  table[state & 0xff] += state;
+                              }
+                              sink = sink + table[state & 0xff];
+                          });
+}
+
+/* Runs body (which performs ops operations) a few times and gates the fastest run per operation,
+relative to the calibration loop, against the baseline entry name */
+template <class Body>
+void gate(const std::string &name, long ops, Body body)
+{
+    const double                     unit = calibration_ns_per_op();
+    PerfCounters                     counters;
+    double                           best = std::numeric_limits<double>::max();
+    std::map<std::string, long long> best_counters;
+    for (int r = 0; r < repetitions; r++)
+    {
+        counters.start();
+        const auto started = std::chrono::steady_clock::now();
+        body();
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        counters.stop();
+
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+        if (ns < best)
+        {
+            best          = ns;
+            best_counters = counters.read();
+        }
+    }
+
+    const double ratio = best / unit;
+    ::testing::Test::RecordProperty(name + "_ns_per_op", std::to_string(best));
+    ::testing::Test::RecordProperty(name + "_ratio", std::to_string(ratio));
+    std::cout << "[perf gate] " << name << ": " << best << " ns/op, calibration " << unit
+              << " ns/op, ratio " << ratio;
+    for (const auto &[counter, value] : best_counters)
+    {
+        ::testing::Test::RecordProperty(name + "_" + counter + "_per_op",
+                                        std::to_string(static_cast<double>(value) / ops));
+        std::cout << ", " << counter << " " << static_cast<double>(value) / ops << "/op";
+    }
+    std::cout << std::endl;
+
+    if (update_mode())
+    {
+        results()[name] = ratio;
+        return;
+    }
+    const Baseline baseline = load_baseline();
+    auto           expected = baseline.ratios.find(name);
+    ASSERT_NE(baseline.ratios.end(), expected)
+        << name << " has no baseline, run with PERF_GATE_UPDATE=1 to record one";
+    auto         tolerance = baseline.tolerances.find(name);
+    const double allowed =
+        tolerance != baseline.tolerances.end() ? tolerance->second : baseline.tolerance;
+    EXPECT_LE(ratio, expected->second * (1.0 + allowed))
+        << name << " regressed: " << ratio << " calibration loops per op against a baseline of "
+        << expected->second;
+}
+
+}  // namespace
+
+TEST(PerfGate, QueuePutPop)
+{
+    SimplestThreadSafeQueue<tao::IncomingEventWrapper> queue;
+    constexpr long                                     ops = 10000;
+    gate("queue_put_pop", ops,
+         [&]()
+         {
+             for (long i = 0; i < ops; i++)
+             {
+                 queue.put(tao::IncomingEventWrapper{tao::InternalEvent::evt_temp_below_target});
+                 queue.wait_and_pop();
+             }
+         });
+}
+
+TEST(PerfGate, StateDispatch)
+{
+    // Heating -> toasting -> door open -> heating
+    static const tao::InternalEvent script[] = {
+        tao::InternalEvent::evt_do_toasting,       tao::InternalEvent::evt_temp_below_target,
+        tao::InternalEvent::evt_temp_above_target, tao::InternalEvent::evt_door_open,
+        tao::InternalEvent::evt_door_close,        tao::InternalEvent::evt_target_temp_reached,
+    };
+    Toaster toaster(std::make_shared<MockObjects::InertHeater>(),
+                    std::make_shared<MockObjects::InertSensor>());
+    constexpr long ops = 6000;
+    gate("state_dispatch", ops,
+         [&]()
+         {
+             for (long i = 0; i < ops; i++)
+                 toaster.state_machine_iteration(script[i % 6]);
+         });
+}
+
+TEST(PerfGate, TimerArmCancel)
+{
+    // Never run: the aborted waits are flushed by poll() on this very thread
+    boost::asio::io_context ioc;
+    DeadlineTimer           timer{ioc.get_executor(), 1000, []() {}, false};
+    constexpr long          ops = 10000;
+    gate("timer_arm_cancel", ops,
+         [&]()
+         {
+             for (long i = 0; i < ops; i++)
+             {
+                 timer.start();
+                 timer.stop();
+             }
+             ioc.poll();
+             ioc.restart();
+         });
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncLogger.hpp"
+
+// Fixture definition
+class AsyncLoggerFixture : public ::testing::Test
+{
+   protected:
+    AsyncLoggerFixture()
+    {
+        // You can do set-up work for each test here.
+        AsyncLogger::set_sink(
+            [this](std::string_view lines)
+            {
+                std::scoped_lock<std::mutex> lock(m_mutex);
+                m_output.append(lines);
+            });
+        AsyncLogger::set_level(AsyncLogger::Level::debug);
+    }
+
+    ~AsyncLoggerFixture()
+    {
+        // You can do clean-up work that doesn't throw exceptions here.
+        AsyncLogger::flush();
+        AsyncLogger::set_sink(nullptr);
+        AsyncLogger::set_level(AsyncLogger::Level::info);
+    }
+
+    std::string output()
+    {
+        AsyncLogger::flush();
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return m_output;
+    }
+
+    std::mutex  m_mutex;
+    std::string m_output;
+};
+
+TEST_F(AsyncLoggerFixture, TestRecordsAreFormattedInTheBackground)
+{
+    ASYNC_LOG_INFO("testAsyncLogger", "answer={} ratio={} name={} ok={}", 42, 1.5, "static", true);
+
+    const std::string out = output();
+    ASSERT_NE(std::string::npos, out.find("[testAsyncLogger][info][thread_id="));
+    ASSERT_NE(std::string::npos, out.find("answer=42 ratio=1.5 name=static ok=true\n"));
+}
+
+TEST_F(AsyncLoggerFixture, TestLevelThreshold)
+{
+    AsyncLogger::set_level(AsyncLogger::Level::warn);
+    ASYNC_LOG_INFO("testAsyncLogger", "filtered out");
+    ASYNC_LOG_ERROR("testAsyncLogger", "kept");
+
+    const std::string out = output();
+    ASSERT_EQ(std::string::npos, out.find("filtered out"));
+    ASSERT_NE(std::string::npos, out.find("[error]"));
+}
+
+TEST_F(AsyncLoggerFixture, TestEachThreadKeepsItsOrder)
+{
+    const int                n_threads = 4;
+    const int                n_records = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++)
+        threads.emplace_back(
+            [t]()
+            {
+                for (int i = 0; i < n_records; i++)
+                    ASYNC_LOG_DEBUG("testAsyncLogger", "order t={} i={}", t, i);
+            });
+    for (auto &thread : threads)
+        thread.join();
+
+    std::vector<int>   next(n_threads, 0);
+    std::istringstream lines(output());
+    std::string        line;
+    while (std::getline(lines, line))
+    {
+        int t, i;
+        if (std::sscanf(line.c_str() + line.find("] ") + 2, "order t=%d i=%d", &t, &i) == 2)
+        {
+            ASSERT_EQ(next[t], i);
+            next[t]++;
+        }
+    }
+    for (int t = 0; t < n_threads; t++)
+        ASSERT_EQ(n_records, next[t]);
+}
+
+TEST_F(AsyncLoggerFixture, TestFullRingDropsInsteadOfBlocking)
+{
+    std::atomic<bool> in_sink{false};
+    std::atomic<bool> release{false};
+    AsyncLogger::set_sink(
+        [&](std::string_view)
+        {
+            in_sink = true;
+            while (!release)
+                std::this_thread::yield();
+        });
+
+    // The background thread gets stuck in the sink with this record still in the ring
+    const auto dropped_before = AsyncLogger::dropped();
+    ASYNC_LOG_DEBUG("testAsyncLogger", "stuck");
+    while (!in_sink)
+        std::this_thread::yield();
+
+    for (std::size_t i = 0; i < AsyncLogger::ring_capacity + 10; i++)
+        ASYNC_LOG_DEBUG("testAsyncLogger", "overflow {}", i);
+
+    release = true;
+    AsyncLogger::flush();
+    ASSERT_EQ(11u, AsyncLogger::dropped() - dropped_before);
+}
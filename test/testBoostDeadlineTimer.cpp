@@ -81,4 +81,46 @@ TEST_F(BoostDeadlineTimerFixture, TestStatus)
     ASSERT_EQ(DeadlineTimer::Status::running, m_timer.status());
     std::this_thread::sleep_for(std::chrono::milliseconds(100 + m_safe_margin));
     ASSERT_EQ(DeadlineTimer::Status::stopped, m_timer.status());
-}
\ No newline at end of file
+}
+
+TEST_F(BoostDeadlineTimerFixture, TestLateness)
+{
+    ASSERT_EQ(0u, m_timer.lateness().expirations);
+
+    m_timer.start(50);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100 + m_safe_margin));
+    m_timer.stop();
+
+    DeadlineTimer::Lateness lateness = m_timer.lateness();
+    ASSERT_EQ(2u, lateness.expirations);
+    ASSERT_LE(lateness.max_ns, lateness.total_ns);
+    ASSERT_LT(lateness.max_ns, static_cast<std::uint64_t>(m_safe_margin) * 1000000);
+}
+
+TEST(BoostDeadlineTimerExecutor, TestRunsOnExternalContext)
+{
+    boost::asio::io_context ioc;
+    int                     counter = 0;
+    DeadlineTimer           timer{ioc.get_executor(), 50, [&counter]() { counter++; }, true};
+
+    timer.start();
+    ioc.run_for(std::chrono::milliseconds(175));
+    ASSERT_EQ(3, counter);
+
+    timer.stop();
+    ioc.run_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(3, counter);
+}
+
+TEST(BoostDeadlineTimerExecutor, TestDestroyedWhileArmed)
+{
+    boost::asio::io_context ioc;
+    int                     counter = 0;
+    {
+        DeadlineTimer timer{ioc.get_executor(), 50, [&counter]() { counter++; }, false};
+        timer.start();
+    }
+    // The aborted wait is still handled by the context, after the timer is gone
+    ioc.run_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(0, counter);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "CompactFleet.hpp"
+#include "MockObjects.hpp"
+
+TEST(CompactFleet, TestFootprint)
+{
+    ASSERT_LE(sizeof(CompactToaster), 256u);
+    ASSERT_EQ(0u, 64 % sizeof(CompactToaster));  // Never straddles a cache line
+}
+
+TEST(CompactFleet, TestSameTrajectoryAsToaster)
+{
+    static const tao::InternalEvent script[] = {
+        tao::InternalEvent::evt_temp_above_target,   tao::InternalEvent::evt_do_toasting,
+        tao::InternalEvent::evt_do_baking,           tao::InternalEvent::evt_temp_below_target,
+        tao::InternalEvent::evt_alarm_timeout,       tao::InternalEvent::evt_do_baking,
+        tao::InternalEvent::evt_target_temp_reached, tao::InternalEvent::evt_door_open,
+        tao::InternalEvent::evt_do_toasting,         tao::InternalEvent::evt_door_close,
+        tao::InternalEvent::evt_do_baking,           tao::InternalEvent::evt_target_temp_reached,
+        tao::InternalEvent::evt_alarm_timeout,       tao::InternalEvent::evt_target_temp_reached,
+    };
+    auto    heater = std::make_shared<MockObjects::InertHeater>();
+    auto    sensor = std::make_shared<MockObjects::InertSensor>();
+    Toaster toaster(heater, sensor);
+
+    Actuators::IHeater::Status compact_heater = Actuators::IHeater::Status::Off;
+    float                      compact_target = 0.0f;
+    CompactFleet               fleet(4, 1,
+                                     {[&](CompactFleet::Handle h, Actuators::IHeater::Status status)
+                                      {
+                                          if (h == 2)
+                                              compact_heater = status;
+                                      },
+                                      [&](CompactFleet::Handle h, float temp)
+                                      {
+                                          if (h == 2)
+                                              compact_target = temp;
+                                      }});
+
+    for (tao::InternalEvent evt : script)
+    {
+        toaster.state_machine_iteration(evt);
+        fleet.step(2, evt);
+        ASSERT_EQ(toaster.m_state->type(), fleet.state(2)) << evt;
+        ASSERT_EQ(toaster.m_door_status == Toaster::DoorStatus::opened, fleet[2].door_open != 0);
+        ASSERT_EQ(heater->get_status(), compact_heater) << evt;
+        ASSERT_FLOAT_EQ(sensor->target_temperature(), compact_target) << evt;
+        ASSERT_EQ(toaster.snapshot().timer_remaining_ms >= 0, fleet[2].timer_deadline_ns >= 0);
+    }
+    // The other toasters didn't move
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, fleet.state(1));
+    ASSERT_EQ(0u, fleet[1].handled);
+}
+
+TEST(CompactFleet, TestWorkersHandleEachToasterInOrder)
+{
+    constexpr CompactFleet::Handle count = 1000;
+    CompactFleet                   fleet(count, 2);
+    fleet.start();
+    for (CompactFleet::Handle h = 0; h < count; h++)
+    {
+        fleet.put_external_entity_event(h, ExternalEntityEvtType::toast_request);
+        fleet.put_external_entity_event(h, ExternalEntityEvtType::opening_door);
+    }
+    while (fleet.dispatched() < 2 * count)
+        std::this_thread::yield();
+
+    for (CompactFleet::Handle h = 0; h < count; h++)
+    {
+        ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, fleet.state(h));
+        ASSERT_EQ(2u, fleet[h].handled);
+        // Leaving toasting disarmed the alarm
+        ASSERT_EQ(-1, fleet[h].timer_deadline_ns);
+    }
+    fleet.stop();
+}
+
+TEST(CompactFleet, TestStoppedToasterDropsEvents)
+{
+    CompactFleet fleet(2, 1);
+    fleet.start();
+    fleet.put_external_entity_event(0, ExternalEntityEvtType::stop_request);
+    fleet.put_external_entity_event(0, ExternalEntityEvtType::toast_request);
+    fleet.put_external_entity_event(1, ExternalEntityEvtType::toast_request);
+    while (fleet.dispatched() < 3)
+        std::this_thread::yield();
+    fleet.stop();
+
+    ASSERT_EQ(0, fleet[0].running);
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, fleet.state(0));
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, fleet.state(1));
+
+    // Started again, only the events put after start(Handle) reach it
+    const std::uint32_t handled = fleet[0].handled;
+    fleet.start();
+    fleet.put_external_entity_event(0, ExternalEntityEvtType::toast_request);
+    fleet.start(0);
+    fleet.put_external_entity_event(0, ExternalEntityEvtType::toast_request);
+    while (fleet.dispatched() < 6)
+        std::this_thread::yield();
+    fleet.stop();
+
+    ASSERT_EQ(1, fleet[0].running);
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, fleet.state(0));
+    ASSERT_EQ(handled + 1, fleet[0].handled);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "EventJournal.hpp"
+#include "MockObjects.hpp"
+#include "ToasterActiveObject.hpp"
+
+// Fixture definition
+class EventJournalFixture : public ::testing::Test
+{
+   protected:
+    EventJournalFixture()
+        : m_directory{::testing::TempDir() + "testEventJournal_"
+                      + ::testing::UnitTest::GetInstance()->current_test_info()->name()}
+    {
+        // You can do set-up work for each test here.
+        std::filesystem::remove_all(m_directory);
+    }
+
+    ~EventJournalFixture()
+    {
+        // You can do clean-up work that doesn't throw exceptions here.
+        std::filesystem::remove_all(m_directory);
+    }
+
+    std::string m_directory;
+};
+
+TEST_F(EventJournalFixture, TestConcurrentAppendsAcrossSegments)
+{
+    constexpr int threads = 4;
+    constexpr int appends = 1000;
+    {
+        EventJournal::Options options;
+        options.segment_records = 64;
+        EventJournal journal(m_directory, "fleet", options);
+
+        std::vector<std::thread> writers;
+        for (int t = 0; t < threads; t++)
+            writers.emplace_back(
+                [&journal, t]()
+                {
+                    for (int i = 0; i < appends; i++)
+                        journal.append(t, static_cast<std::uint16_t>(i));
+                });
+        for (auto &writer : writers)
+            writer.join();
+        journal.commit();
+        ASSERT_GE(journal.commits(), 1u);
+        ASSERT_GE(journal.segments(), std::uint64_t{threads * appends / 64});
+    }
+
+    auto records = EventJournal::read(m_directory, "fleet");
+    ASSERT_EQ(std::size_t{threads * appends}, records.size());
+    // Append order is kept for each writer
+    std::vector<int> next(threads, 0);
+    for (const auto &record : records)
+    {
+        ASSERT_LT(record.source, std::uint32_t{threads});
+        ASSERT_EQ(next[record.source]++, record.event);
+        ASSERT_NE(0, record.timestamp_ns);
+    }
+}
+
+TEST_F(EventJournalFixture, TestReopeningAppendsAfterPreviousSegments)
+{
+    {
+        EventJournal journal(m_directory, "fleet");
+        journal.append(1, 10);
+    }
+    {
+        EventJournal journal(m_directory, "fleet");
+        journal.append(1, 20);
+    }
+    // Segments of another journal in the same directory are left alone
+    {
+        EventJournal journal(m_directory, "other");
+        journal.append(2, 30);
+    }
+
+    auto records = EventJournal::read(m_directory, "fleet");
+    ASSERT_EQ(2u, records.size());
+    ASSERT_EQ(10, records[0].event);
+    ASSERT_EQ(20, records[1].event);
+    ASSERT_LE(records[0].timestamp_ns, records[1].timestamp_ns);
+}
+
+TEST_F(EventJournalFixture, TestToasterJournalsIncomingEvents)
+{
+    auto sensor  = std::make_shared<MockObjects::InertSensor>();
+    auto journal = std::make_shared<EventJournal>(m_directory, "toaster");
+    {
+        Toaster toaster(std::make_shared<MockObjects::InertHeater>(), sensor);
+        toaster.set_journal(journal, 7);
+        toaster.put_external_entity_event(ExternalEntityEvtType::toast_request);
+        sensor->publish(TempSensorEvtType::temp_below_target);
+        // Not an event the toaster takes, so not journaled either
+        toaster.put_external_entity_event(ExternalEntityEvtType::unknown);
+    }
+    journal.reset();
+
+    auto records = EventJournal::read(m_directory, "toaster");
+    ASSERT_EQ(2u, records.size());
+    ASSERT_EQ(7u, records[0].source);
+    ASSERT_EQ(tao::InternalEvent::evt_do_toasting,
+              tao::IncomingEventWrapper::decode(records[0].event)
+                  .map_incoming_event_to_internal_event());
+    ASSERT_EQ(tao::InternalEvent::evt_temp_below_target,
+              tao::IncomingEventWrapper::decode(records[1].event)
+                  .map_incoming_event_to_internal_event());
+}
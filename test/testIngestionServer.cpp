@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "IngestionServer.hpp"
+#include "MockObjects.hpp"
+
+// Fixture definition
+class IngestionServerFixture : public ::testing::Test
+{
+   protected:
+    IngestionServerFixture()
+        : m_path{"/tmp/testIngestionServer." + std::to_string(getpid()) + ".sock"}
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            m_toasters.push_back(std::make_shared<Toaster>(
+                std::make_shared<MockObjects::InertHeater>(),
+                std::make_shared<MockObjects::InertSensor>()));
+            m_toasters.back()->start();
+        }
+    }
+
+    ~IngestionServerFixture()
+    {
+        for (auto &toaster : m_toasters)
+            toaster->stop();
+    }
+
+    int connect_client()
+    {
+        int         fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, m_path.c_str());
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Gives up after a second
+    template <class Predicate>
+    bool wait_until(Predicate predicate)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (!predicate() && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return predicate();
+    }
+
+    std::string                           m_path;
+    std::vector<std::shared_ptr<Toaster>> m_toasters;
+};
+
+TEST_F(IngestionServerFixture, TestRoutesFramesToToasters)
+{
+    IngestionServer server{m_path};
+    for (auto &toaster : m_toasters)
+        server.add_toaster(toaster);
+    server.start();
+
+    auto external = [](ExternalEntityEvtType type)
+    { return tao::IncomingEventWrapper{ExternalEntityEvent{type}}.encode(); };
+    const std::vector<std::pair<std::uint32_t, std::uint16_t>> commands = {
+        {0, external(ExternalEntityEvtType::toast_request)},
+        {1, external(ExternalEntityEvtType::opening_door)},
+        {7, external(ExternalEntityEvtType::toast_request)},  // No such toaster
+        {0, tao::IncomingEventWrapper{tao::InternalEvent::evt_alarm_timeout}.encode()},
+        {1, external(ExternalEntityEvtType::unknown)},
+    };
+    std::vector<char> stream(commands.size() * IngestionServer::frame_size);
+    for (std::size_t i = 0; i < commands.size(); i++)
+        IngestionServer::write_frame(&stream[i * IngestionServer::frame_size], commands[i].first,
+                                     commands[i].second);
+
+    // Two clients, the first one cutting a frame in two writes
+    int first  = connect_client();
+    int second = connect_client();
+    ASSERT_GE(first, 0);
+    ASSERT_GE(second, 0);
+    ASSERT_EQ(4, write(first, stream.data(), 4));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(8, write(first, stream.data() + 4, 8));
+    ASSERT_EQ(18, write(second, stream.data() + 12, 18));
+
+    ASSERT_TRUE(wait_until([&]() { return server.stats().frames == 5; }));
+    ASSERT_TRUE(wait_until(
+        [&]()
+        {
+            return m_toasters[0]->m_trace.recorded() == 1 && m_toasters[1]->m_trace.recorded() == 1;
+        }));
+    EXPECT_EQ(tao::StateValue::STATE_TOASTING, m_toasters[0]->m_state->type());
+    EXPECT_EQ(tao::StateValue::STATE_DOOR_OPEN, m_toasters[1]->m_state->type());
+
+    auto stats = server.stats();
+    EXPECT_EQ(2u, stats.connections);
+    EXPECT_EQ(3u, stats.rejected);
+    EXPECT_GE(stats.batches, 2u);
+
+    close(first);
+    close(second);
+    server.stop();
+}
+
+TEST_F(IngestionServerFixture, TestNeverReplacesOtherFiles)
+{
+    std::ofstream(m_path) << "not a socket";
+    ASSERT_THROW(IngestionServer{m_path}, std::system_error);
+    ASSERT_EQ(0, access(m_path.c_str(), F_OK));
+    unlink(m_path.c_str());
+
+    // A socket left behind by a server that didn't shut down is replaced
+    int         fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, m_path.c_str());
+    ASSERT_EQ(0, bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+    close(fd);
+    IngestionServer server{m_path};
+    server.start();
+    int client = connect_client();
+    ASSERT_GE(client, 0);
+    ASSERT_TRUE(wait_until([&]() { return server.stats().connections == 1; }));
+    close(client);
+    server.stop();
+}
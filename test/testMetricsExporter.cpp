@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "MetricsExporter.hpp"
+
+// Fixture definition
+class MetricsExporterFixture : public ::testing::Test
+{
+   protected:
+    MetricsExporterFixture()
+        : m_thermal_state{std::make_shared<DemoObjects::ThermalState>()},
+          m_toaster{std::make_shared<Toaster>(
+              std::make_shared<DemoObjects::HeaterDemo>(m_thermal_state),
+              std::make_shared<DemoObjects::TempSensorDemo>(m_thermal_state))},
+          m_path{"/tmp/testMetricsExporter." + std::to_string(getpid()) + ".sock"}
+    {
+    }
+
+    std::string scrape()
+    {
+        int         fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, m_path.c_str());
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            close(fd);
+            return {};
+        }
+        const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+        write(fd, request.data(), request.size());
+
+        std::string response;
+        char        buffer[4096];
+        ssize_t     received;
+        while ((received = read(fd, buffer, sizeof(buffer))) > 0)
+            response.append(buffer, static_cast<size_t>(received));
+        close(fd);
+        return response;
+    }
+
+    std::shared_ptr<DemoObjects::ThermalState> m_thermal_state;
+    std::shared_ptr<Toaster>                   m_toaster;
+    std::string                                m_path;
+};
+
+TEST_F(MetricsExporterFixture, TestRender)
+{
+    MetricsExporter exporter{MetricsExporter::Endpoint::tcp(0)};
+    exporter.add_toaster("front \"left\"", m_toaster);
+
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_alarm_timeout);
+
+    std::ostringstream os;
+    exporter.render(os);
+    const std::string text = os.str();
+
+    const std::string label = "toaster=\"front \\\"left\\\"\"";
+    ASSERT_NE(std::string::npos, text.find("# TYPE toaster_queue_depth gauge\n"));
+    ASSERT_NE(std::string::npos, text.find("toaster_queue_depth{" + label + "} 0\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("toaster_events_total{" + label + ",event=\"evt_do_toasting\"} 1\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("toaster_event_latency_seconds_count{" + label
+                        + ",event=\"evt_alarm_timeout\"} 1\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("toaster_state_entries_total{" + label + ",state=\"STATE_TOASTING\"} 1\n"));
+    ASSERT_NE(std::string::npos, text.find("toaster_timer_expirations_total{" + label + "} 0\n"));
+    // Thread CPU time is only known while the toaster runs its own thread
+    ASSERT_EQ(std::string::npos, text.find("toaster_thread_cpu_seconds_total{"));
+
+    // Each family is described once
+    ASSERT_EQ(text.find("# HELP toaster_events_total"), text.rfind("# HELP toaster_events_total"));
+    ASSERT_NE(0u, exporter.port());
+}
+
+TEST_F(MetricsExporterFixture, TestScrapeOverUnixSocket)
+{
+    MetricsExporter exporter{MetricsExporter::Endpoint::unix_socket(m_path)};
+    exporter.add_toaster("toaster", m_toaster);
+    exporter.start();
+    m_toaster->start();
+
+    const std::string response = scrape();
+    ASSERT_EQ(0u, response.rfind("HTTP/1.0 200 OK\r\n", 0));
+    ASSERT_NE(std::string::npos, response.find("Content-Type: text/plain; version=0.0.4"));
+    ASSERT_NE(std::string::npos,
+              response.find("toaster_thread_cpu_seconds_total{toaster=\"toaster\"}"));
+
+    m_toaster->stop();
+    exporter.stop();
+}
+
+TEST_F(MetricsExporterFixture, TestNeverReplacesOtherFiles)
+{
+    std::ofstream(m_path) << "not a socket";
+    ASSERT_THROW(MetricsExporter{MetricsExporter::Endpoint::unix_socket(m_path)},
+                 std::system_error);
+    ASSERT_EQ(0, access(m_path.c_str(), F_OK));
+    unlink(m_path.c_str());
+
+    // A socket left behind by a process that didn't clean up is replaced
+    int         fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, m_path.c_str());
+    ASSERT_EQ(0, bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+    close(fd);
+    MetricsExporter exporter{MetricsExporter::Endpoint::unix_socket(m_path)};
+    exporter.start();
+    ASSERT_EQ(0u, scrape().rfind("HTTP/1.0 200 OK\r\n", 0));
+    exporter.stop();
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Seqlock.hpp"
+
+struct Pair
+{
+    long first;
+    long second;
+};
+
+TEST(SeqlockValue, TestLoadReturnsWhatWasStored)
+{
+    SeqlockValue<Pair> value;
+    value.store(Pair{1, 2});
+    Pair loaded = value.load();
+    ASSERT_EQ(1, loaded.first);
+    ASSERT_EQ(2, loaded.second);
+}
+
+TEST(SeqlockValue, TestReadersNeverSeeTornWrites)
+{
+    SeqlockValue<Pair> value{Pair{0, 0}};
+    std::atomic<bool>  done{false};
+
+    auto reader = [&]()
+    {
+        long last = 0;
+        while (!done)
+        {
+            Pair snapshot = value.load();
+            ASSERT_EQ(snapshot.first, -snapshot.second);
+            ASSERT_GE(snapshot.first, last);
+            last = snapshot.first;
+        }
+    };
+
+    std::vector<std::thread> readers;
+    readers.emplace_back(reader);
+    readers.emplace_back(reader);
+    for (long i = 1; i <= 200000; i++)
+        value.store(Pair{i, -i});
+    done = true;
+    for (auto &thread : readers)
+        thread.join();
+}
@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "ThermalModel.hpp"
+#include "ThermalSimulation.hpp"
+#include "ToasterActiveObject.hpp"
+
+// Fixture definition
+class ThermalSimulationFixture : public ::testing::Test
+{
+   protected:
+    ThermalSimulationFixture() : m_engine{m_capacity}
+    {
+        // You can do set-up work for each test here.
+    }
+
+    static const std::size_t      m_capacity = 4;
+    ThermalSimulation::FleetEngine m_engine;
+};
+
+TEST_F(ThermalSimulationFixture, TestSlotsAreIndependent)
+{
+    auto heated = m_engine.add_slot();
+    auto idle   = m_engine.add_slot();
+    m_engine.set_heater(heated, true);
+
+    for (int i = 0; i < 10; i++)
+        m_engine.tick();
+
+    ASSERT_FLOAT_EQ(35.0f, m_engine.temperature(heated));
+    ASSERT_FLOAT_EQ(25.0f, m_engine.temperature(idle));
+
+    for (int i = 0; i < 100; i++)
+        m_engine.tick();
+    ASSERT_FLOAT_EQ(80.0f, m_engine.temperature(heated));
+}
+
+TEST_F(ThermalSimulationFixture, TestOnlyCrossingsArePublished)
+{
+    auto slot = m_engine.add_slot();
+    m_engine.set_target_temperature(slot, 30.0f);
+    m_engine.set_heater(slot, true);
+
+    std::vector<TempSensorEvtType> events;
+    m_engine.set_crossings_handler(
+        [&events](const ThermalSimulation::Crossing *crossings, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; i++)
+                events.push_back(crossings[i].event);
+        });
+
+    // 26, 27, 28: below the 30 +- 2 band, then 29..31 inside it, then 32 and above
+    for (int i = 0; i < 10; i++)
+        m_engine.tick();
+
+    ASSERT_EQ(3u, events.size());
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, events[0]);
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, events[1]);
+    ASSERT_EQ(TempSensorEvtType::temp_above_target, events[2]);
+}
+
+TEST_F(ThermalSimulationFixture, TestTargetChangePublishesAgain)
+{
+    auto slot = m_engine.add_slot();
+    m_engine.set_target_temperature(slot, 60.0f);
+    std::vector<TempSensorEvtType> events;
+    m_engine.set_crossings_handler(
+        [&events](const ThermalSimulation::Crossing *crossings, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; i++)
+                events.push_back(crossings[i].event);
+        });
+    m_engine.tick();
+    ASSERT_EQ(1u, events.size());
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, events[0]);
+
+    // Still below the new target, a toaster waiting on the sensor must hear about it anyway
+    m_engine.set_target_temperature(slot, 50.0f);
+    m_engine.tick();
+    ASSERT_EQ(2u, events.size());
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, events[1]);
+
+    // Setting the same target again isn't a change
+    m_engine.set_target_temperature(slot, 50.0f);
+    m_engine.tick();
+    ASSERT_EQ(2u, events.size());
+}
+
+TEST_F(ThermalSimulationFixture, TestToasterDrivenBySimulatedSlot)
+{
+    boost::asio::io_context ioc;
+    auto                    slot    = m_engine.add_slot();
+    auto                    toaster = std::make_shared<Toaster>(
+        ioc, std::make_shared<ThermalSimulation::SimulatedHeater>(m_engine, slot),
+        std::make_shared<ThermalSimulation::SimulatedTempSensor>(m_engine, slot));
+    toaster->start();
+
+    // Entering the heating superstate drives the slot directly
+    ASSERT_TRUE(m_engine.heater(slot));
+    ASSERT_FLOAT_EQ(DEMO_MAX_TEMP, m_engine.target_temperature(slot));
+
+    toaster->put_external_entity_event(ExternalEntityEvtType::opening_door);
+    ioc.poll();
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, toaster->m_state->type());
+    ASSERT_FALSE(m_engine.heater(slot));
+
+    // The first tick classifies the slot and feeds the toaster through its sensor adapter
+    m_engine.tick();
+    ASSERT_EQ(1u, m_engine.last_crossings().size());
+    ioc.poll();
+    ASSERT_FALSE(m_engine.heater(slot));
+
+    toaster->stop();
+}
+
+TEST_F(ThermalSimulationFixture, TestHysteresisFromPublishPolicy)
+{
+    auto                                   slot = m_engine.add_slot(0.5f);
+    ThermalSimulation::SimulatedTempSensor sensor{m_engine, slot};
+    sensor.set_publish_policy(Sensors::PublishPolicy{Sensors::PublishPolicy::Mode::edge, 3.0f});
+    sensor.set_target_temperature(30.0f);
+    m_engine.set_heater(slot, true);
+
+    std::vector<TempSensorEvtType> events;
+    sensor.initialize([&events](const TempSensorEvent &evt) { events.push_back(evt.which()); });
+
+    // Below until 30 - 0.5 + 3, then reached until 30 + 0.5 + 3
+    for (int i = 0; i < 12; i++)
+        m_engine.tick();
+
+    ASSERT_EQ(3u, events.size());
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, events[0]);
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, events[1]);
+    ASSERT_EQ(TempSensorEvtType::temp_above_target, events[2]);
+    ASSERT_FLOAT_EQ(37.0f, m_engine.temperature(slot));
+}
+
+
+TEST(ThermalModel, TestBatchAdvanceMatchesSingleSteps)
+{
+    ThermalSimulation::ThermalModel stepped, batched;
+    stepped.set_heater(true);
+    batched.set_heater(true);
+
+    for (int i = 0; i < 5000; i++)
+        stepped.step();
+    batched.advance(5000);
+
+    ASSERT_NEAR(stepped.temperature(), batched.temperature(), 1e-3);
+    ASSERT_GT(batched.temperature(), 25.0f);
+}
+
+TEST(ThermalModel, TestConvergesToEquilibrium)
+{
+    ThermalSimulation::ThermalModel model;
+    model.set_heater(true);
+    // 20 minutes at 1 kHz, about 12 time constants
+    model.advance(20 * 60 * 1000);
+    ASSERT_NEAR(85.0f, model.temperature(), 0.01f);
+
+    model.set_heater(false);
+    model.advance(20 * 60 * 1000);
+    ASSERT_NEAR(25.0f, model.temperature(), 0.01f);
+}
+
+TEST(ThermalModel, TestAdvanceForKeepsTheRemainder)
+{
+    ThermalSimulation::ThermalModel model;
+    ASSERT_EQ(0u, model.advance_for(std::chrono::microseconds(600)));
+    ASSERT_EQ(1u, model.advance_for(std::chrono::microseconds(600)));
+    ASSERT_EQ(1000u, model.advance_for(std::chrono::seconds(1)));
+}
+
+TEST(ThermalModel, TestClosedLoopHoldsTarget)
+{
+    ThermalSimulation::ThermalModel model;
+    Sensors::TempClassifier         classifier;
+    Sensors::PublishPolicy          policy{Sensors::PublishPolicy::Mode::edge, 0.5f};
+    const float                     target = 60.0f, error = 1.0f;
+    auto                            now    = Sensors::TempClassifier::clock::now();
+
+    float highest = 0.0f, lowest = 100.0f;
+    // Five minutes of bang-bang control, the sensor read every 10 ms of simulated time
+    for (int i = 0; i < 5 * 60 * 100; i++)
+    {
+        model.advance(10);
+        now += std::chrono::milliseconds(10);
+        auto evt = classifier.update(model.temperature(), target, error, policy, now);
+        if (evt == TempSensorEvtType::temp_below_target)
+            model.set_heater(true);
+        else if (evt == TempSensorEvtType::temp_above_target)
+            model.set_heater(false);
+
+        if (i > 3 * 60 * 100)
+        {
+            highest = std::max(highest, model.temperature());
+            lowest  = std::min(lowest, model.temperature());
+        }
+    }
+    ASSERT_LT(highest, target + error + 1.0f);
+    ASSERT_GT(lowest, target - error - 1.0f);
+}
+
+TEST(ThermalModel, TestHeaterDemoPhysicalMode)
+{
+    auto                                    state = std::make_shared<DemoObjects::ThermalState>();
+    ThermalSimulation::ThermalModel::Params params;
+    params.heat_capacity    = 1.0f;
+    params.heater_power     = 100.0f;
+    params.loss_coefficient = 1.0f;
+    DemoObjects::HeaterDemo heater{params, state, 10};
+    heater.turn_on();
+
+    // Time constant is 1 s: ~18 degrees after 200 ms whatever the 10 ms ticks look like
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    DemoObjects::ThermalSnapshot snapshot = state->read();
+    ASSERT_GT(snapshot.temperature, 35.0f);
+    ASSERT_LT(snapshot.temperature, 50.0f);
+    ASSERT_EQ(Actuators::IHeater::Status::On, snapshot.heater);
+}
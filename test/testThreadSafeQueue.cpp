@@ -68,4 +68,16 @@ TEST_F(ThreadSafeQueueFixture, TestPoppingWholeString)
     threads.emplace_back(runner, m_queue);
     for (auto& thread : threads)
         thread.join();
-}
\ No newline at end of file
+}
+TEST_F(ThreadSafeQueueFixture, TestSizeFollowsPutsAndPops)
+{
+    ASSERT_EQ(0u, m_queue->size());
+    m_queue->put(std::move(m_test_string1));
+    m_queue->put_prioritized(std::move(m_test_string2));
+    ASSERT_EQ(2u, m_queue->size());
+
+    m_queue->wait_and_pop();
+    ASSERT_EQ(1u, m_queue->size());
+    m_queue->clear();
+    ASSERT_EQ(0u, m_queue->size());
+}
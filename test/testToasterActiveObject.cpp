@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <vector>
 
+#include "MockObjects.hpp"
 #include "ToasterActiveObject.hpp"
 
 // Fixture definition
@@ -9,9 +13,11 @@ class ToasterActiveObjectFixture : public ::testing::Test
 {
    protected:
     ToasterActiveObjectFixture()
-        : m_toaster{std::make_shared<Toaster>(
-            std::make_shared<DemoObjects::HeaterDemo>(),  // Soon to be changed to MockObjects
-            std::make_shared<DemoObjects::TempSensorDemo>())}
+        : m_thermal_state{std::make_shared<DemoObjects::ThermalState>()},
+          m_toaster{std::make_shared<Toaster>(
+              // Soon to be changed to MockObjects
+              std::make_shared<DemoObjects::HeaterDemo>(m_thermal_state),
+              std::make_shared<DemoObjects::TempSensorDemo>(m_thermal_state))}
     {
         // You can do set-up work for each test here.
     }
@@ -43,7 +49,8 @@ class ToasterActiveObjectFixture : public ::testing::Test
         }
     }
 
-    std::shared_ptr<Toaster> m_toaster;
+    std::shared_ptr<DemoObjects::ThermalState> m_thermal_state;
+    std::shared_ptr<Toaster>                   m_toaster;
 };
 
 TEST_F(ToasterActiveObjectFixture, TestDefaultStart)
@@ -82,3 +89,648 @@ TEST_F(ToasterActiveObjectFixture, TestEventToastInterruptedBecauseOfOpenDoor)
     external_event_putter(ExternalEntityEvtType::opening_door);
     ASSERT_TRUE(assertState(tao::StateValue::STATE_DOOR_OPEN));
 }
+
+
+TEST(ToasterActiveObjectExecutor, TestToastersShareOneContext)
+{
+    boost::asio::io_context ioc;
+    auto                    thermal1 = std::make_shared<DemoObjects::ThermalState>();
+    auto                    thermal2 = std::make_shared<DemoObjects::ThermalState>();
+    auto                    toaster1 = std::make_shared<Toaster>(
+        ioc, std::make_shared<DemoObjects::HeaterDemo>(ioc.get_executor(), thermal1),
+        std::make_shared<DemoObjects::TempSensorDemo>(ioc.get_executor(), thermal1));
+    auto toaster2 = std::make_shared<Toaster>(
+        ioc, std::make_shared<DemoObjects::HeaterDemo>(ioc.get_executor(), thermal2),
+        std::make_shared<DemoObjects::TempSensorDemo>(ioc.get_executor(), thermal2));
+    toaster1->start();
+    toaster2->start();
+
+    toaster1->put_external_entity_event(ExternalEntityEvtType::toast_request);
+    toaster2->put_external_entity_event(ExternalEntityEvtType::bake_request);
+    // Nothing happens until the context runs the posted handlers
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, toaster1->m_state->type());
+    ASSERT_EQ(nullptr, toaster1->m_queue);
+    ASSERT_EQ(1u, toaster1->queue_depth());
+
+    ioc.poll();
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, toaster1->m_state->type());
+    ASSERT_EQ(tao::StateValue::STATE_BAKING, toaster2->m_state->type());
+    ASSERT_EQ(0u, toaster1->queue_depth());
+
+    toaster1->stop();
+    toaster2->stop();
+}
+
+TEST(ToasterActiveObjectExecutor, TestTimerExpiresOnSameContext)
+{
+    boost::asio::io_context ioc;
+    auto                    thermal_state = std::make_shared<DemoObjects::ThermalState>();
+    auto                    toaster       = std::make_shared<Toaster>(
+        ioc, std::make_shared<DemoObjects::HeaterDemo>(ioc.get_executor(), thermal_state),
+        std::make_shared<DemoObjects::TempSensorDemo>(ioc.get_executor(), thermal_state));
+    toaster->start();
+
+    toaster->put_external_entity_event(ExternalEntityEvtType::toast_request);
+    ioc.poll();
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, toaster->m_state->type());
+
+    // Shorten the toasting alarm, its expiration must bring the toaster back to heating
+    toaster->disarm_time_event();
+    toaster->arm_time_event(50);
+    ioc.run_for(std::chrono::milliseconds(150));
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, toaster->m_state->type());
+    // Counted like the toast request, as it is in thread mode
+    ASSERT_EQ(2u, toaster->m_metrics.dispatched());
+
+    toaster->stop();
+}
+
+TEST(ToasterActiveObjectExecutor, TestHandlersOutliveToaster)
+{
+    boost::asio::io_context ioc;
+    auto                    heater  = std::make_shared<MockObjects::InertHeater>();
+    auto                    toaster = std::make_unique<Toaster>(
+        ioc, heater, std::make_shared<MockObjects::InertSensor>());
+    toaster->start();
+    toaster->put_external_entity_event(ExternalEntityEvtType::toast_request);
+    ioc.poll();
+    // The toasting alarm is armed and another event is posted when the toaster goes away
+    toaster->put_external_entity_event(ExternalEntityEvtType::opening_door);
+    toaster.reset();
+
+    // Both are skipped, the door opening would have turned the heater off
+    ioc.run_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(Actuators::IHeater::Status::On, heater->get_status());
+}
+
+TEST(ToasterActiveObjectExecutor, TestSnapshotRestoreRoundTrip)
+{
+    boost::asio::io_context ioc;
+    auto                    heater  = std::make_shared<MockObjects::InertHeater>();
+    Toaster                 toaster(ioc, heater, std::make_shared<MockObjects::InertSensor>());
+    toaster.start();
+    toaster.put_external_entity_event(ExternalEntityEvtType::toast_request);
+    ioc.poll();
+    toaster.set_target_temperature(42.5f);
+
+    // Posted events can't be read back from the executor, they are only counted
+    toaster.put_temp_sensor_event(TempSensorEvtType::temp_below_target);
+    toaster.put_external_entity_event(ExternalEntityEvtType::opening_door);
+    tao::ToasterSnapshot snapshot = toaster.snapshot();
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, static_cast<tao::StateValue>(snapshot.state));
+    ASSERT_EQ(0u, snapshot.queued_count);
+    ASSERT_EQ(2u, snapshot.queued_dropped);
+    ASSERT_GT(snapshot.timer_remaining_ms, 0);
+    toaster.stop();
+    ioc.poll();
+
+    // Queued events of a snapshot go through the executor of the restored toaster
+    snapshot.queued[snapshot.queued_count++] =
+        tao::IncomingEventWrapper{TempSensorEvent{TempSensorEvtType::temp_below_target}}.encode();
+    snapshot.queued[snapshot.queued_count++] =
+        tao::IncomingEventWrapper{ExternalEntityEvent{ExternalEntityEvtType::opening_door}}.encode();
+    auto    restored_heater = std::make_shared<MockObjects::InertHeater>();
+    Toaster restored(ioc, restored_heater, std::make_shared<MockObjects::InertSensor>());
+    restored.start();
+    ASSERT_TRUE(restored.restore(snapshot));
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, restored.m_state->type());
+    ASSERT_EQ(Actuators::IHeater::Status::On, restored_heater->get_status());
+    ASSERT_FLOAT_EQ(42.5f, restored.target_temperature());
+    ASSERT_EQ(2u, restored.queue_depth());
+    ASSERT_GT(restored.snapshot().timer_remaining_ms, 0);
+
+    ioc.poll();
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, restored.m_state->type());
+    ASSERT_EQ(Actuators::IHeater::Status::Off, restored_heater->get_status());
+    ASSERT_EQ(0u, restored.queue_depth());
+    restored.stop();
+}
+
+TEST_F(ToasterActiveObjectFixture, TestBakeProgramRunsToCompletion)
+{
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_baking);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_BAKING));
+    ASSERT_TRUE(m_toaster->m_program.awaits(tao::InternalEvent::evt_target_temp_reached));
+    ASSERT_GT(m_toaster->m_frame_arena.in_use(), 0u);
+
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_target_temp_reached);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_BAKING));
+    ASSERT_TRUE(m_toaster->m_program.awaits(tao::InternalEvent::evt_alarm_timeout));
+
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_alarm_timeout);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_HEATING));
+    // Back in heating only, which restores its own target
+    ASSERT_FLOAT_EQ(tao::HeatingSuperState::target_temperature(),
+                    m_toaster->target_temperature());
+    ASSERT_FALSE(m_toaster->m_program.valid());
+    ASSERT_EQ(0u, m_toaster->m_frame_arena.in_use());
+}
+
+TEST(ToasterActiveObject, TestHeaterBackOnAfterBaking)
+{
+    auto    heater = std::make_shared<MockObjects::InertHeater>();
+    Toaster toaster(heater, std::make_shared<MockObjects::InertSensor>());
+    toaster.state_machine_iteration(tao::InternalEvent::evt_do_baking);
+    toaster.state_machine_iteration(tao::InternalEvent::evt_target_temp_reached);
+    toaster.state_machine_iteration(tao::InternalEvent::evt_temp_above_target);
+    ASSERT_EQ(Actuators::IHeater::Status::Off, heater->get_status());
+
+    // Heating doesn't wait for the next sensor edge to heat again
+    toaster.state_machine_iteration(tao::InternalEvent::evt_alarm_timeout);
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, toaster.m_state->type());
+    ASSERT_EQ(Actuators::IHeater::Status::On, heater->get_status());
+}
+
+TEST_F(ToasterActiveObjectFixture, TestBakingRefusedWhenArenaIsFull)
+{
+    void *filler = m_toaster->m_frame_arena.allocate(tao::FrameArena::capacity);
+    ASSERT_NE(nullptr, filler);
+
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_baking);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_HEATING));
+    ASSERT_FALSE(m_toaster->m_program.valid());
+
+    m_toaster->m_frame_arena.deallocate(filler, tao::FrameArena::capacity);
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_baking);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_BAKING));
+    ASSERT_TRUE(m_toaster->m_program.valid());
+}
+
+// The toaster only picks the arena the frame is allocated from
+TAO_COOKING_PROGRAM_BEGIN
+static tao::CookingProgram two_step_program(ToasterCore &, int &steps)
+{
+    co_await tao::heat_until(60);
+    steps++;
+    co_await tao::wait_for(tao::InternalEvent::evt_temp_above_target);
+    steps++;
+}
+TAO_COOKING_PROGRAM_END
+
+TEST_F(ToasterActiveObjectFixture, TestProgramOnlyConsumesAwaitedEvents)
+{
+    int steps = 0;
+    m_toaster->run_program(two_step_program(*m_toaster, steps));
+    ASSERT_EQ(0, steps);
+
+    // Not awaited, goes to the current state as usual
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_TOASTING));
+    ASSERT_EQ(0, steps);
+
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_target_temp_reached);
+    ASSERT_EQ(1, steps);
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_temp_above_target);
+    ASSERT_EQ(2, steps);
+    ASSERT_TRUE(m_toaster->m_program.done());
+}
+
+TEST(HeaterOutputStage, TestOnlyChangesReachTheHeater)
+{
+    const std::string path   = ::testing::TempDir() + "testHeaterOutputStage.value";
+    auto              heater = std::make_shared<MockObjects::FileHeater>(path);
+    auto read_value = [&path]() { return std::ifstream(path).get(); };
+    {
+        // Nothing heats the sensor's ThermalState, it stays at ambient temperature
+        Toaster toaster(heater, std::make_shared<DemoObjects::TempSensorDemo>(
+                                    std::make_shared<DemoObjects::ThermalState>()));
+
+        // Entering heating turns the heater on
+        ASSERT_EQ(1u, heater->writes());
+        ASSERT_EQ('1', read_value());
+
+        // Already on
+        toaster.state_machine_iteration(tao::InternalEvent::evt_temp_below_target);
+        toaster.state_machine_iteration(tao::InternalEvent::evt_temp_below_target);
+        ASSERT_EQ(1u, heater->writes());
+
+        // Leaving heating for the door turns it off, closing the door back on, in two steps
+        toaster.state_machine_iteration(tao::InternalEvent::evt_door_open);
+        ASSERT_EQ(2u, heater->writes());
+        ASSERT_EQ('0', read_value());
+        toaster.state_machine_iteration(tao::InternalEvent::evt_door_close);
+        ASSERT_EQ(3u, heater->writes());
+        ASSERT_EQ('1', read_value());
+
+        // Turned off and on again within the same step
+        toaster.heater_off();
+        toaster.heater_on();
+        toaster.state_machine_iteration(tao::InternalEvent::unknown);
+        ASSERT_EQ(3u, heater->writes());
+
+        toaster.state_machine_iteration(tao::InternalEvent::evt_temp_above_target);
+        ASSERT_EQ(4u, heater->writes());
+        ASSERT_EQ('0', read_value());
+        ASSERT_GT(toaster.heater_output().requests(), toaster.heater_output().writes());
+        ASSERT_EQ(heater->writes(), toaster.heater_output().writes());
+    }
+    std::remove(path.c_str());
+}
+
+TEST(StateHierarchy, TestTransitionsStopAtLeastCommonAncestor)
+{
+    using tao::StateValue;
+
+    // Into and out of a substate: heating is neither exited nor re-entered
+    auto into = tao::transition_path(StateValue::STATE_HEATING, StateValue::STATE_TOASTING);
+    ASSERT_EQ(0u, into.exit_count);
+    ASSERT_EQ(1u, into.entry_count);
+    ASSERT_TRUE(StateValue::STATE_TOASTING == into.entries[0]);
+
+    auto back = tao::transition_path(StateValue::STATE_BAKING, StateValue::STATE_HEATING);
+    ASSERT_EQ(1u, back.exit_count);
+    ASSERT_TRUE(StateValue::STATE_BAKING == back.exits[0]);
+    ASSERT_EQ(0u, back.entry_count);
+
+    auto sibling = tao::transition_path(StateValue::STATE_TOASTING, StateValue::STATE_BAKING);
+    ASSERT_EQ(1u, sibling.exit_count);
+    ASSERT_EQ(1u, sibling.entry_count);
+
+    // Across the top of the hierarchy, innermost state exited first, outermost entered first
+    auto away = tao::transition_path(StateValue::STATE_TOASTING, StateValue::STATE_DOOR_OPEN);
+    ASSERT_EQ(2u, away.exit_count);
+    ASSERT_TRUE(StateValue::STATE_TOASTING == away.exits[0]);
+    ASSERT_TRUE(StateValue::STATE_HEATING == away.exits[1]);
+    ASSERT_EQ(1u, away.entry_count);
+
+    auto initial = tao::transition_path(StateValue::UNKNOWN, StateValue::STATE_BAKING);
+    ASSERT_EQ(0u, initial.exit_count);
+    ASSERT_EQ(2u, initial.entry_count);
+    ASSERT_TRUE(StateValue::STATE_HEATING == initial.entries[0]);
+    ASSERT_TRUE(StateValue::STATE_BAKING == initial.entries[1]);
+
+    // Self transitions are external
+    auto self = tao::transition_path(StateValue::STATE_HEATING, StateValue::STATE_HEATING);
+    ASSERT_EQ(1u, self.exit_count);
+    ASSERT_EQ(1u, self.entry_count);
+}
+
+TEST_F(ToasterActiveObjectFixture, TestToastingKeepsHeatingActions)
+{
+    const auto requests = m_toaster->heater_output().requests();
+    const auto writes   = m_toaster->heater_output().writes();
+
+    // Going into toasting doesn't touch the heater
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_TOASTING));
+    ASSERT_EQ(requests, m_toaster->heater_output().requests());
+
+    // Coming back asks for it on again, the heater is on already so it isn't written to
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_alarm_timeout);
+    ASSERT_TRUE(assertState(tao::StateValue::STATE_HEATING));
+    ASSERT_EQ(writes, m_toaster->heater_output().writes());
+}
+
+TEST_F(ToasterActiveObjectFixture, TestStepsAreRecorded)
+{
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_temp_below_target);
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_alarm_timeout);
+
+    auto steps = m_toaster->m_trace.snapshot();
+    ASSERT_EQ(3u, steps.size());
+    ASSERT_TRUE(tao::InternalEvent::evt_do_toasting == steps[0].event);
+    ASSERT_TRUE(tao::StateValue::STATE_HEATING == steps[0].before);
+    ASSERT_TRUE(tao::StateValue::STATE_TOASTING == steps[0].after);
+    ASSERT_TRUE(tao::StateValue::STATE_TOASTING == steps[1].after);
+    ASSERT_TRUE(tao::StateValue::STATE_HEATING == steps[2].after);
+    ASSERT_LE(steps[0].timestamp_ns, steps[1].timestamp_ns);
+
+    std::ostringstream json;
+    tao::export_chrome_trace(json, steps);
+    ASSERT_EQ(0u, json.str().find("{\"displayTimeUnit\""));
+    ASSERT_NE(std::string::npos, json.str().find("\"name\":\"evt_do_toasting\""));
+    ASSERT_NE(std::string::npos, json.str().find("\"name\":\"STATE_TOASTING\",\"cat\":\"state\""));
+}
+
+TEST(TraceRecorder, TestRingKeepsTheLastSteps)
+{
+    tao::TraceRecorder recorder(4);
+    auto               now = tao::TraceRecorder::clock::now();
+    for (int i = 0; i < 10; i++)
+        recorder.record(tao::InternalEvent::evt_temp_below_target, tao::StateValue::STATE_HEATING,
+                        tao::StateValue::STATE_HEATING, now, now, i);
+
+    auto steps = recorder.snapshot();
+    ASSERT_EQ(10u, recorder.recorded());
+    ASSERT_EQ(4u, steps.size());
+    ASSERT_EQ(6u, steps.front().index);
+    ASSERT_EQ(9u, steps.back().queue_depth);
+
+    recorder.set_enabled(false);
+    recorder.record(tao::InternalEvent::evt_stop, tao::StateValue::STATE_HEATING,
+                    tao::StateValue::STATE_HEATING, now, now, 0);
+    ASSERT_EQ(10u, recorder.recorded());
+}
+
+TEST_F(ToasterActiveObjectFixture, TestMetricsPerStateAndEvent)
+{
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_temp_below_target);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_alarm_timeout);
+    // Nobody cares about it in heating
+    m_toaster->state_machine_iteration(tao::InternalEvent::evt_target_temp_reached);
+
+    auto metrics = m_toaster->m_metrics.snapshot();
+    ASSERT_EQ(2u, metrics.state(tao::StateValue::STATE_HEATING).entries);
+    ASSERT_EQ(1u, metrics.state(tao::StateValue::STATE_TOASTING).entries);
+    ASSERT_EQ(0u, metrics.state(tao::StateValue::STATE_BAKING).entries);
+    ASSERT_GE(metrics.state(tao::StateValue::STATE_TOASTING).dwell_ns, 5000000u);
+
+    const auto &toasting = metrics.event(tao::InternalEvent::evt_do_toasting);
+    ASSERT_EQ(1u, toasting.count);
+    std::uint64_t in_histogram = 0;
+    for (auto count : toasting.latency.counts)
+        in_histogram += count;
+    ASSERT_EQ(1u, in_histogram);
+    ASSERT_GE(toasting.latency.percentile(0.5), toasting.total_ns);
+
+    ASSERT_EQ(1u, metrics.unhandled_events);
+}
+
+TEST(ToasterMetrics, TestDispatchLatencyOfQueuedEvents)
+{
+    auto    heater = std::make_shared<MockObjects::InertHeater>();
+    auto    sensor = std::make_shared<MockObjects::InertSensor>();
+    Toaster toaster(heater, sensor);
+
+    // Stepped directly, never queued
+    toaster.state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+    ASSERT_EQ(0u, toaster.m_metrics.snapshot().dispatch.count);
+
+    sensor->publish(TempSensorEvtType::temp_above_target);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    toaster.state_machine_iteration();
+
+    auto metrics = toaster.m_metrics.snapshot();
+    ASSERT_EQ(1u, metrics.dispatch.count);
+    ASSERT_GE(metrics.dispatch.total_ns, 2000000u);
+    ASSERT_EQ(1u, metrics.event(tao::InternalEvent::evt_temp_above_target).count);
+    ASSERT_EQ(Actuators::IHeater::Status::Off, heater->get_status());
+    ASSERT_EQ(2u, heater->commands());
+}
+
+TEST(ToasterActiveObject, TestRestartAfterStopRequest)
+{
+    auto    sensor = std::make_shared<MockObjects::InertSensor>();
+    Toaster toaster(std::make_shared<MockObjects::InertHeater>(), sensor);
+    toaster.start();
+
+    // The thread ends on its own, stop() still joins it so that start() can run another one
+    toaster.put_external_entity_event(ExternalEntityEvtType::stop_request);
+    while (toaster.m_running)
+        std::this_thread::yield();
+    toaster.stop();
+    toaster.start();
+
+    sensor->publish(TempSensorEvtType::temp_below_target);
+    while (toaster.m_metrics.dispatched() < 2)
+        std::this_thread::yield();
+    ASSERT_TRUE(toaster.m_running);
+    toaster.stop();
+}
+
+TEST(BasicToaster, TestStaticBindingBehavesLikeToaster)
+{
+    using InertToaster = BasicToaster<SimplestThreadSafeQueue<tao::IncomingEventWrapper>,
+                                      MockObjects::InertHeater, MockObjects::InertSensor>;
+    auto         heater = std::make_shared<MockObjects::InertHeater>();
+    auto         sensor = std::make_shared<MockObjects::InertSensor>();
+    InertToaster toaster(heater, sensor);
+
+    // Entry actions of the heating state reached the heater and the sensor
+    ASSERT_EQ(Actuators::IHeater::Status::On, heater->get_status());
+    ASSERT_FLOAT_EQ(DEMO_MAX_TEMP, sensor->target_temperature());
+
+    sensor->publish(TempSensorEvtType::temp_above_target);
+    toaster.state_machine_iteration();
+    ASSERT_EQ(Actuators::IHeater::Status::Off, heater->get_status());
+
+    toaster.put_external_entity_event(ExternalEntityEvtType::opening_door);
+    toaster.state_machine_iteration();
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, toaster.m_state->type());
+    ASSERT_FLOAT_EQ(DEMO_AMBIENT_TEMP, sensor->target_temperature());
+    ASSERT_EQ(2u, toaster.m_metrics.dispatched());
+}
+
+TEST(LatencyHistogram, TestLogLinearBuckets)
+{
+    using tao::LatencyHistogram;
+
+    for (std::uint32_t ns : {0u, 7u, 8u, 9u, 1000u, 123456u, 4000000000u})
+    {
+        const auto bucket = LatencyHistogram::bucket_of(ns);
+        ASSERT_LE(LatencyHistogram::lower_bound(bucket), ns);
+        if (bucket + 1 < LatencyHistogram::bucket_count)
+        {
+            ASSERT_GT(LatencyHistogram::lower_bound(bucket + 1), ns);
+        }
+        // Never more than 12.5% off
+        ASSERT_LE(ns - LatencyHistogram::lower_bound(bucket), ns / 8);
+    }
+    ASSERT_EQ(LatencyHistogram::bucket_count - 1, LatencyHistogram::bucket_of(UINT32_MAX));
+
+    LatencyHistogram histogram;
+    for (std::uint32_t i = 0; i < 99; i++)
+        histogram.add(100);
+    histogram.add(100000);
+    ASSERT_EQ(103u, histogram.percentile(0.5));  // 100 lands in [96, 104)
+    ASSERT_GE(histogram.percentile(1.0), 100000u);
+}
+
+TEST(TempClassifier, TestLevelModePublishesEveryReading)
+{
+    Sensors::TempClassifier classifier;
+    Sensors::PublishPolicy  policy;
+    auto                    now = Sensors::TempClassifier::clock::now();
+
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, classifier.update(40, 50, 2, policy, now));
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, classifier.update(41, 50, 2, policy, now));
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, classifier.update(49, 50, 2, policy, now));
+    ASSERT_EQ(TempSensorEvtType::temp_above_target, classifier.update(52, 50, 2, policy, now));
+}
+
+TEST(TempClassifier, TestEdgeModeWithHysteresis)
+{
+    Sensors::TempClassifier classifier;
+    Sensors::PublishPolicy  policy{Sensors::PublishPolicy::Mode::edge, 1.0f};
+    auto                    now = Sensors::TempClassifier::clock::now();
+
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, classifier.update(50, 50, 2, policy, now));
+    ASSERT_FALSE(classifier.update(50.5f, 50, 2, policy, now));
+    // 52.5 is past the band but within the hysteresis
+    ASSERT_FALSE(classifier.update(52.5f, 50, 2, policy, now));
+    ASSERT_EQ(TempSensorEvtType::temp_above_target, classifier.update(53, 50, 2, policy, now));
+    // Coming back needs to go under 51
+    ASSERT_FALSE(classifier.update(51.5f, 50, 2, policy, now));
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, classifier.update(50.9f, 50, 2, policy, now));
+
+    classifier.invalidate();
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, classifier.update(50, 50, 2, policy, now));
+}
+
+TEST(TempClassifier, TestRateLimitDelaysChanges)
+{
+    Sensors::TempClassifier classifier;
+    Sensors::PublishPolicy  policy{Sensors::PublishPolicy::Mode::edge, 0.0f,
+                                  std::chrono::milliseconds(100)};
+    auto                    now = Sensors::TempClassifier::clock::now();
+
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, classifier.update(40, 50, 2, policy, now));
+    ASSERT_FALSE(classifier.update(50, 50, 2, policy, now + std::chrono::milliseconds(10)));
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached,
+              classifier.update(50, 50, 2, policy, now + std::chrono::milliseconds(110)));
+}
+
+
+TEST(TempHistory, TestStatisticsOverWindow)
+{
+    Sensors::TempHistory history{4, 0.5f};
+    auto                 t0 = Sensors::TempHistory::clock::now();
+    const float          readings[]{30, 20, 40, 35, 25, 26};
+    for (int i = 0; i < 6; i++)
+        history.push(readings[i], t0 + std::chrono::seconds(i));
+
+    Sensors::TempStats stats = history.stats();
+    ASSERT_EQ(4u, stats.count);
+    ASSERT_FLOAT_EQ(26.0f, stats.last);
+    // Window is 40, 35, 25, 26: 30 and 20 are gone
+    ASSERT_FLOAT_EQ(25.0f, stats.min);
+    ASSERT_FLOAT_EQ(40.0f, stats.max);
+    ASSERT_FLOAT_EQ(-14.0f / 3.0f, stats.rate_per_s);
+
+    Sensors::TempSample samples[8];
+    ASSERT_EQ(4u, history.samples(samples, 8));
+    ASSERT_FLOAT_EQ(40.0f, samples[0].temp);
+    ASSERT_FLOAT_EQ(26.0f, samples[3].temp);
+}
+
+TEST(TempHistory, TestPredictsTimeToReachTarget)
+{
+    Sensors::TempHistory history{8};
+    auto                 t0 = Sensors::TempHistory::clock::now();
+    ASSERT_FALSE(history.time_to_reach(50));
+
+    for (int i = 0; i < 5; i++)
+        history.push(25.0f + 2.0f * i, t0 + std::chrono::seconds(i));
+
+    // 33 now, heating at 2 degrees per second
+    ASSERT_EQ(std::chrono::milliseconds(8500), history.time_to_reach(50));
+    ASSERT_FALSE(history.time_to_reach(20));
+}
+
+TEST(ToasterActiveObject, TestTimeToTargetFromSensorHistory)
+{
+    auto    sensor = std::make_shared<MockObjects::InertSensor>();
+    Toaster toaster(std::make_shared<MockObjects::InertHeater>(), sensor);
+    ASSERT_FALSE(toaster.time_to_target_temperature());
+
+    // Heating aims at DEMO_MAX_TEMP, warming up 1 degree a second
+    const auto t0 = Sensors::TempHistory::clock::now();
+    sensor->record(DEMO_AMBIENT_TEMP, t0);
+    sensor->record(DEMO_AMBIENT_TEMP + 2.0f, t0 + std::chrono::seconds(2));
+    const auto eta = toaster.time_to_target_temperature();
+    ASSERT_TRUE(eta.has_value());
+    ASSERT_EQ(std::chrono::seconds(static_cast<long>(DEMO_MAX_TEMP - DEMO_AMBIENT_TEMP) - 2), *eta);
+
+    // What the states and cooking programs see
+    const ToasterCore &core = toaster;
+    ASSERT_EQ(eta, core.time_to_target_temperature());
+}
+
+TEST(ThermalState, TestEachToasterHasItsOwnTemperature)
+{
+    ThermalSimulation::ThermalModel::Params params;
+    params.heat_capacity = 1.0f;
+    auto                    heated_state = std::make_shared<DemoObjects::ThermalState>();
+    auto                    idle_state   = std::make_shared<DemoObjects::ThermalState>();
+    DemoObjects::HeaterDemo heated{params, heated_state, 10};
+    DemoObjects::HeaterDemo idle{params, idle_state, 10};
+    heated.turn_on();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    DemoObjects::ThermalSnapshot first = heated_state->read();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    DemoObjects::ThermalSnapshot second = heated_state->read();
+
+    ASSERT_GT(first.temperature, DEMO_AMBIENT_TEMP);
+    ASSERT_GE(second.temperature, first.temperature);
+    ASSERT_GT(second.timestamp_ns, first.timestamp_ns);
+    ASSERT_EQ(Actuators::IHeater::Status::On, second.heater);
+    ASSERT_FLOAT_EQ(DEMO_AMBIENT_TEMP, idle_state->read().temperature);
+}
+
+TEST(IncomingEventWrapper, TestEncodeDecodeRoundTrip)
+{
+    const tao::IncomingEventWrapper events[] = {
+        tao::IncomingEventWrapper{ExternalEntityEvent{ExternalEntityEvtType::bake_request}},
+        tao::IncomingEventWrapper{TempSensorEvent{TempSensorEvtType::temp_above_target}},
+        tao::IncomingEventWrapper{tao::InternalEvent::evt_alarm_timeout},
+    };
+    for (auto event : events)
+    {
+        auto decoded = tao::IncomingEventWrapper::decode(event.encode());
+        ASSERT_EQ(event.encode(), decoded.encode());
+        ASSERT_EQ(event.map_incoming_event_to_internal_event(),
+                  decoded.map_incoming_event_to_internal_event());
+    }
+    ASSERT_EQ(tao::InternalEvent::unknown,
+              tao::IncomingEventWrapper::decode(0).map_incoming_event_to_internal_event());
+}
+
+TEST(ToasterSnapshot, TestWarmRestartThroughFleetFile)
+{
+    const std::string path = ::testing::TempDir() + "testToasterSnapshot.fleet";
+    std::remove(path.c_str());
+    {
+        auto    sensor = std::make_shared<MockObjects::InertSensor>();
+        Toaster toasting(std::make_shared<MockObjects::InertHeater>(), sensor);
+        Toaster door_open(std::make_shared<MockObjects::InertHeater>(),
+                          std::make_shared<MockObjects::InertSensor>());
+        toasting.state_machine_iteration(tao::InternalEvent::evt_do_toasting);
+        toasting.set_target_temperature(42.5f);
+        sensor->publish(TempSensorEvtType::temp_below_target);
+        toasting.put_external_entity_event(ExternalEntityEvtType::opening_door);
+        door_open.state_machine_iteration(tao::InternalEvent::evt_door_open);
+
+        tao::SnapshotFile fleet(path, 3);
+        fleet[0] = toasting.snapshot();
+        fleet[2] = door_open.snapshot();
+        fleet.sync();
+    }
+
+    tao::SnapshotFile fleet(path);
+    ASSERT_EQ(3u, fleet.size());
+    ASSERT_EQ(2u, fleet[0].queued_count);
+    ASSERT_GT(fleet[0].timer_remaining_ms, 0);
+    ASSERT_LE(fleet[0].timer_remaining_ms, 6000);
+    ASSERT_EQ(-1, fleet[2].timer_remaining_ms);
+
+    auto    heater = std::make_shared<MockObjects::InertHeater>();
+    Toaster restored(heater, std::make_shared<MockObjects::InertSensor>());
+    ASSERT_TRUE(restored.restore(fleet[0]));
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, restored.m_state->type());
+    ASSERT_EQ(Actuators::IHeater::Status::On, heater->get_status());
+    tao::ToasterSnapshot again = restored.snapshot();
+    ASSERT_FLOAT_EQ(42.5f, again.target_temp);
+    ASSERT_GT(again.timer_remaining_ms, 0);
+    ASSERT_LE(again.timer_remaining_ms, fleet[0].timer_remaining_ms);
+
+    // The queued events come out in their original order
+    restored.state_machine_iteration();
+    ASSERT_EQ(tao::StateValue::STATE_TOASTING, restored.m_state->type());
+    restored.state_machine_iteration();
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, restored.m_state->type());
+    ASSERT_EQ(0u, restored.m_queue->size());
+
+    // Restoring over a toaster in another state leaves it first
+    ASSERT_TRUE(restored.restore(fleet[2]));
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, restored.m_state->type());
+    ASSERT_EQ(Toaster::DoorStatus::opened, restored.m_door_status);
+    ASSERT_EQ(-1, restored.snapshot().timer_remaining_ms);
+
+    ASSERT_FALSE(restored.restore(fleet[1]));
+    ASSERT_THROW(tao::SnapshotFile(path, 4), std::runtime_error);
+    std::remove(path.c_str());
+}
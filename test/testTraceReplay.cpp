@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventJournal.hpp"
+#include "EventReplay.hpp"
+#include "MockObjects.hpp"
+#include "ToasterActiveObject.hpp"
+#include "TraceReplay.hpp"
+
+// Fixture definition
+class TraceReplayFixture : public ::testing::Test
+{
+   protected:
+    TraceReplayFixture()
+        : m_path{::testing::TempDir() + "testTraceReplay_"
+                 + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".trace"}
+    {
+        // You can do set-up work for each test here.
+    }
+
+    ~TraceReplayFixture()
+    {
+        // You can do clean-up work that doesn't throw exceptions here.
+        std::remove(m_path.c_str());
+    }
+
+    void write(const std::string &csv)
+    {
+        std::istringstream in(csv);
+        TraceReplay::write_trace(m_path, TraceReplay::parse_csv(in));
+    }
+
+    std::string m_path;
+};
+
+TEST_F(TraceReplayFixture, TestCsvRoundTrip)
+{
+    write("offset_ms,temperature\n"
+          "0,25.5\n"
+          "# door opened\n"
+          "\n"
+          "250,26\n"
+          "500,27.25\n");
+
+    TraceReplay::TraceFile trace(m_path);
+    ASSERT_EQ(3u, trace.size());
+    ASSERT_EQ(250u, trace[1].offset_ms);
+    ASSERT_FLOAT_EQ(27.25f, trace[2].temperature);
+
+    std::istringstream out_of_order("0,25\n100,26\n50,27\n");
+    ASSERT_THROW(TraceReplay::parse_csv(out_of_order), std::runtime_error);
+    std::istringstream too_late("0,25\n4294967296,26\n");
+    ASSERT_THROW(TraceReplay::parse_csv(too_late), std::runtime_error);
+
+    std::ofstream(m_path, std::ios::trunc) << "not a trace at all";
+    ASSERT_THROW(TraceReplay::TraceFile{m_path}, std::runtime_error);
+}
+
+TEST_F(TraceReplayFixture, TestStepPublishesOnRecordedTime)
+{
+    // 10 s recording, one sample per second from 20 to 29 degrees
+    std::ostringstream csv;
+    for (int i = 0; i < 10; i++)
+        csv << i * 1000 << "," << 20 + i << "\n";
+    write(csv.str());
+
+    TraceReplay::TraceReplaySensor sensor(m_path);
+    std::vector<TempSensorEvtType> events;
+    sensor.initialize([&events](const TempSensorEvent &evt) { events.push_back(evt.which()); });
+    sensor.set_publish_policy(Sensors::PublishPolicy{Sensors::PublishPolicy::Mode::edge});
+    sensor.set_target_temperature(24.0f);
+
+    while (sensor.step())
+    {
+    }
+    ASSERT_TRUE(sensor.finished());
+    ASSERT_FLOAT_EQ(29.0f, sensor.get_temperature());
+
+    // 20..22 below, 23..25 within 24 +- 2 (exclusive bounds), 26.. above
+    ASSERT_EQ(3u, events.size());
+    ASSERT_EQ(TempSensorEvtType::temp_below_target, events[0]);
+    ASSERT_EQ(TempSensorEvtType::target_temp_reached, events[1]);
+    ASSERT_EQ(TempSensorEvtType::temp_above_target, events[2]);
+
+    // Replayed in no time, but the history sees the recording's 1 degree per second
+    auto stats = sensor.history()->stats();
+    ASSERT_EQ(10u, stats.count);
+    ASSERT_NEAR(1.0f, stats.rate_per_s, 1e-3f);
+}
+
+TEST_F(TraceReplayFixture, TestRealTimePacing)
+{
+    write("0,25\n100,26\n200,27\n");
+
+    TraceReplay::TraceReplaySensor sensor(m_path,
+                                          TraceReplay::TraceReplaySensor::Pacing::real_time);
+    sensor.initialize([](const TempSensorEvent &) {});
+
+    auto started = std::chrono::steady_clock::now();
+    sensor.start();
+    sensor.wait();
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    ASSERT_TRUE(sensor.finished());
+    ASSERT_GE(elapsed, std::chrono::milliseconds(200));
+}
+
+TEST_F(TraceReplayFixture, TestDrivesToasterInPlaceOfDemoSensor)
+{
+    // Cold oven, then overshooting the 80 degrees the heating state aims at
+    write("0,25\n1000,60\n2000,85\n");
+
+    // Its temperature goes nowhere, the replayed trace stands for the sensor
+    auto heater = std::make_shared<DemoObjects::HeaterDemo>(
+        std::make_shared<DemoObjects::ThermalState>());
+    auto sensor = std::make_shared<TraceReplay::TraceReplaySensor>(
+        m_path, TraceReplay::TraceReplaySensor::Pacing::as_fast_as_possible);
+    sensor->set_publish_policy(Sensors::PublishPolicy{Sensors::PublishPolicy::Mode::edge});
+    Toaster toaster(heater, sensor);
+
+    // The initial transition into heating already set the sensor target
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, toaster.m_state->type());
+
+    // Until the toaster thread dispatched count events, at most a second
+    const auto wait_dispatched = [&toaster](std::uint64_t count)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (toaster.m_metrics.dispatched() < count
+               && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return toaster.m_metrics.dispatched() >= count;
+    };
+    toaster.start();
+
+    sensor->step();
+    ASSERT_TRUE(wait_dispatched(1));
+    ASSERT_EQ(Actuators::IHeater::Status::On, heater->get_status());
+
+    sensor->step();  // Still below, nothing published
+    sensor->step();
+    ASSERT_TRUE(wait_dispatched(2));
+    ASSERT_EQ(Actuators::IHeater::Status::Off, heater->get_status());
+    toaster.stop();
+}
+
+TEST_F(TraceReplayFixture, TestEventReplayFollowsRecordedTrajectory)
+{
+    // Heating -> toasting -> door open -> heating -> baking, alarm included
+    const tao::InternalEvent script[] = {
+        tao::InternalEvent::evt_do_toasting,  tao::InternalEvent::evt_temp_above_target,
+        tao::InternalEvent::evt_door_open,    tao::InternalEvent::evt_door_close,
+        tao::InternalEvent::evt_do_toasting,  tao::InternalEvent::evt_alarm_timeout,
+        tao::InternalEvent::evt_do_baking,    tao::InternalEvent::evt_target_temp_reached,
+        tao::InternalEvent::evt_alarm_timeout,
+    };
+    Toaster toaster(std::make_shared<MockObjects::InertHeater>(),
+                    std::make_shared<MockObjects::InertSensor>());
+    for (auto event : script)
+        toaster.state_machine_iteration(event);
+
+    TraceReplay::write_recording(m_path,
+                                 TraceReplay::recording_from_steps(toaster.m_trace.snapshot()));
+    auto recording = TraceReplay::read_recording(m_path);
+    ASSERT_EQ(9u, recording.size());
+
+    auto report = TraceReplay::replay_events(recording);
+    ASSERT_TRUE(report.matched()) << report;
+    ASSERT_EQ(9u, report.steps);
+    ASSERT_EQ(toaster.m_state->type(), report.final_state);
+
+    // A recording that went elsewhere is caught at the step it diverged
+    recording[2].after = static_cast<std::uint8_t>(tao::StateValue::STATE_BAKING);
+    report             = TraceReplay::replay_events(recording);
+    ASSERT_FALSE(report.matched());
+    ASSERT_EQ(1u, report.mismatch_count);
+    ASSERT_EQ(2u, report.mismatches[0].step);
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, report.mismatches[0].actual_after);
+
+    // Starts where the recording starts
+    recording.erase(recording.begin(), recording.begin() + 3);
+    report = TraceReplay::replay_events(recording);
+    ASSERT_TRUE(report.matched()) << report;
+}
+
+TEST(EventReplay, TestRebuildsStateFromJournal)
+{
+    auto encode = [](tao::InternalEvent event)
+    { return tao::IncomingEventWrapper{event}.encode(); };
+    const std::vector<JournalRecord> journal = {
+        {1000, 1, encode(tao::InternalEvent::evt_do_toasting), 0},
+        {2000, 2, encode(tao::InternalEvent::evt_door_open), 0},
+        {3000, 1, encode(tao::InternalEvent::evt_door_open), 0},
+    };
+    auto report = TraceReplay::replay_events(TraceReplay::recording_from_journal(journal, 1));
+    ASSERT_TRUE(report.matched());
+    ASSERT_EQ(2u, report.steps);
+    ASSERT_EQ(std::chrono::nanoseconds(2000), report.recorded_duration);
+    ASSERT_EQ(tao::StateValue::STATE_DOOR_OPEN, report.final_state);
+}
+
+TEST(EventReplay, TestAlarmOvertakesQueuedEvents)
+{
+    const std::string directory = ::testing::TempDir() + "testEventReplay_journal";
+    std::filesystem::remove_all(directory);
+    auto journal = std::make_shared<EventJournal>(directory, "toaster");
+    {
+        Toaster toaster(std::make_shared<MockObjects::InertHeater>(),
+                        std::make_shared<MockObjects::InertSensor>());
+        toaster.set_journal(journal, 1);
+        toaster.put_external_entity_event(ExternalEntityEvtType::toast_request);
+        toaster.state_machine_iteration();
+        ASSERT_EQ(tao::StateValue::STATE_TOASTING, toaster.m_state->type());
+
+        // The toasting alarm expires while the bake request is still queued
+        toaster.put_external_entity_event(ExternalEntityEvtType::bake_request);
+        toaster.disarm_time_event();
+        toaster.arm_time_event(1);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (toaster.queue_depth() < 2 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        toaster.state_machine_iteration();
+        toaster.state_machine_iteration();
+        ASSERT_EQ(tao::StateValue::STATE_BAKING, toaster.m_state->type());
+    }
+    journal.reset();
+
+    auto recording =
+        TraceReplay::recording_from_journal(EventJournal::read(directory, "toaster"), 1);
+    std::filesystem::remove_all(directory);
+    ASSERT_EQ(3u, recording.size());
+    ASSERT_EQ(TraceReplay::RecordedStep::prioritized, recording[2].flags);
+    ASSERT_EQ(1u, recording[2].queue_depth);
+
+    // Journaled after the bake request, the alarm is still replayed ahead of it
+    auto report = TraceReplay::replay_events(recording);
+    ASSERT_EQ(3u, report.steps);
+    ASSERT_EQ(tao::StateValue::STATE_BAKING, report.final_state);
+
+    // Had the bake request been dispatched first, toasting would have ended on it
+    recording[2].queue_depth = 0;
+    report                   = TraceReplay::replay_events(recording);
+    ASSERT_EQ(tao::StateValue::STATE_HEATING, report.final_state);
+}